@@ -321,7 +321,9 @@
  *          buffers.
  */
 #if !defined(SERIAL_BUFFERS_SIZE) || defined(__DOXYGEN__)
-#define SERIAL_BUFFERS_SIZE         32
+/* The longest frame (5 bytes of header, 64 of payload and the CRC) and
+   room for an ACK next to it, rounded up; checked in commands.c. */
+#define SERIAL_BUFFERS_SIZE         80
 #endif
 
 /*===========================================================================*/
@@ -19,6 +19,7 @@
 #include "commands.h"
 #include "hal.h"
 #include "light_utils.h"
+#include "link.h"
 #include "matrix.h"
 #include "miniFastLED.h"
 #include "profiles.h"
@@ -26,7 +27,9 @@
 #include "settings.h"
 #include "string.h"
 
-static const SerialConfig usart1Config = {.speed = 115200};
+/* Received bytes are drained from the serial queue in chunks, large enough
+ * for the longest message */
+static uint8_t rxBuffer[80];
 
 /*
  * Application entry point.
@@ -47,7 +50,7 @@ int main(void) {
   matrixInit();
 
   palClearLine(LINE_LED_PWR);
-  sdStart(&SD1, &usart1Config);
+  linkInit();
 
   /* Make sure the SD is empty */
   while (!sdGetWouldBlock(&SD1))
@@ -56,14 +59,26 @@ int main(void) {
   chThdSetPriority(HIGHPRIO);
 
   // start the handler for commands coming from the main MCU
+  commandsInit();
   protoInit(&proto, commandCallback);
-  msg_t msg;
+  bool waitingForAck = false;
   while (true) {
-    msg = sdGetTimeout(&SD1, TIME_MS2I(100));
-    if (msg == MSG_TIMEOUT) {
+    /* Wait for a burst; silence inside a frame means the rest was lost */
+    sysinterval_t timeout = TIME_MS2I(100);
+    if (proto.state != STATE_SYNC_1)
+      timeout = linkIdle;
+    else if (waitingForAck)
+      timeout = TIME_MS2I(PROTO_ACK_TIMEOUT_MS);
+    if (chEvtWaitAnyTimeout(LINK_EVENT, timeout) == 0) {
       protoSilence(&proto);
-    } else {
-      protoConsume(&proto, msg);
     }
+
+    size_t size;
+    while ((size = sdAsynchronousRead(&SD1, rxBuffer, sizeof(rxBuffer))) > 0) {
+      protoConsumeBuffer(&proto, rxBuffer, size);
+    }
+    linkPoll();
+    waitingForAck = protoTxPoll();
+    commandsSendReplies();
   }
 }
@@ -0,0 +1,19 @@
+/*
+    ===  activeSet  ===
+    Keys with a pending animation.
+*/
+#include "activeSet.h"
+
+void activeSetAdd(active_set_t *set, uint8_t key, uint8_t stamp) {
+  set->stamp[key] = stamp;
+  if (activeSetHas(set, key))
+    return;
+  set->bits[key >> 3] |= 1 << (key & 7);
+  set->keys[set->count++] = key;
+}
+
+void activeSetRemoveAt(active_set_t *set, uint8_t pos) {
+  const uint8_t key = set->keys[pos];
+  set->bits[key >> 3] &= ~(1 << (key & 7));
+  set->keys[pos] = set->keys[--set->count];
+}
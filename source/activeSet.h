@@ -0,0 +1,45 @@
+#ifndef ACTIVESET_INCLUDED
+#define ACTIVESET_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * Set of keys with a pending animation, for reactive profiles.
+ *
+ * A bitmap answers "is this key active" in O(1) and a compact list of the
+ * active keys lets profiles update only those, so an idle profile costs
+ * nothing and heavy typing costs O(keys in flight).
+ *
+ * Instead of counters decremented on every frame, each key remembers the tick
+ * it was activated at; profiles derive the animation value from its age. The
+ * clock only runs while some key is active. Stamps are 8-bit, so animations
+ * must end within 127 ticks.
+ */
+
+typedef struct {
+  uint8_t bits[(KEY_COUNT + 7) / 8];
+  uint8_t count;
+  /* Current tick */
+  uint8_t now;
+  /* Active keys, in no particular order */
+  uint8_t keys[KEY_COUNT];
+  /* Tick the key was activated at, indexed by key */
+  uint8_t stamp[KEY_COUNT];
+} active_set_t;
+
+static inline bool activeSetHas(const active_set_t *set, uint8_t key) {
+  return set->bits[key >> 3] & (1 << (key & 7));
+}
+
+/* Ticks since the key was activated; negative for stamps in the future */
+static inline int8_t activeSetAge(const active_set_t *set, uint8_t key) {
+  return (int8_t)(set->now - set->stamp[key]);
+}
+
+/* Activate a key, or restart it if it's already active */
+void activeSetAdd(active_set_t *set, uint8_t key, uint8_t stamp);
+
+/* Deactivate the key at `pos` in the list; the last key takes its place. */
+void activeSetRemoveAt(active_set_t *set, uint8_t pos);
+
+#endif
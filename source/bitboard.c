@@ -0,0 +1,54 @@
+/*
+    ===  bitboard  ===
+    Whole-board operations on key bitboards.
+*/
+#include "bitboard.h"
+
+static inline uint16_t rowOrZero(const bitboard_t *board, int8_t row) {
+  return row >= 0 && row < NUM_ROW ? board->rows[row] : 0;
+}
+
+/* Add one bit-plane to a 3-bit counter held in s0..s2, all columns at once */
+static inline void addPlane(uint16_t *s0, uint16_t *s1, uint16_t *s2,
+                            uint16_t x) {
+  const uint16_t c0 = *s0 & x;
+  *s0 ^= x;
+  const uint16_t c1 = *s1 & c0;
+  *s1 ^= c0;
+  *s2 ^= c1;
+}
+
+void bitboardNeighbours(const bitboard_t *board, bitboard_t count[3]) {
+  for (int8_t row = 0; row < NUM_ROW; row++) {
+    const uint16_t up = rowOrZero(board, row - 1);
+    const uint16_t mid = board->rows[row];
+    const uint16_t down = rowOrZero(board, row + 1);
+    uint16_t s0 = 0, s1 = 0, s2 = 0;
+
+    addPlane(&s0, &s1, &s2, bitboardRowLeft(up));
+    addPlane(&s0, &s1, &s2, up);
+    addPlane(&s0, &s1, &s2, bitboardRowRight(up));
+    addPlane(&s0, &s1, &s2, bitboardRowLeft(mid));
+    addPlane(&s0, &s1, &s2, bitboardRowRight(mid));
+    addPlane(&s0, &s1, &s2, bitboardRowLeft(down));
+    addPlane(&s0, &s1, &s2, down);
+    addPlane(&s0, &s1, &s2, bitboardRowRight(down));
+
+    count[0].rows[row] = s0;
+    count[1].rows[row] = s1;
+    count[2].rows[row] = s2;
+  }
+}
+
+void bitboardDilate(const bitboard_t *board, bitboard_t *out) {
+  /* Spread horizontally first, then every row takes its neighbour rows */
+  uint16_t wide[NUM_ROW];
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    const uint16_t bits = board->rows[row];
+    wide[row] = bits | bitboardRowLeft(bits) | bitboardRowRight(bits);
+  }
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    out->rows[row] = wide[row] | (row > 0 ? wide[row - 1] : 0) |
+                     (row + 1 < NUM_ROW ? wide[row + 1] : 0);
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef BITBOARD_INCLUDED
+#define BITBOARD_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * One bit per key, a 16-bit word per matrix row (bit n is column n).
+ *
+ * Testing a key is O(1) and set keys are iterated with count-trailing-zeros,
+ * so the cost depends on the number of set keys, not on KEY_COUNT:
+ *
+ *   for (uint8_t row = 0; row < NUM_ROW; row++) {
+ *     for (uint16_t bits = board.rows[row]; bits; bits &= bits - 1) {
+ *       const uint8_t col = bitboardLowest(bits);
+ *       ...
+ *     }
+ *   }
+ *
+ * Whole-board operations (shifts, neighbour counts) work on the row words, so
+ * a generation of a cellular automaton is a few dozen word operations.
+ */
+
+typedef struct {
+  uint16_t rows[NUM_ROW];
+} bitboard_t;
+
+#define BITBOARD_ROW_MASK ((1u << NUM_COLUMN) - 1)
+
+static inline void bitboardClearAll(bitboard_t *board) {
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    board->rows[row] = 0;
+  }
+}
+
+static inline void bitboardSet(bitboard_t *board, uint8_t row, uint8_t col) {
+  board->rows[row] |= 1u << col;
+}
+
+static inline void bitboardClear(bitboard_t *board, uint8_t row, uint8_t col) {
+  board->rows[row] &= ~(1u << col);
+}
+
+static inline bool bitboardTest(const bitboard_t *board, uint8_t row,
+                                uint8_t col) {
+  return board->rows[row] & (1u << col);
+}
+
+static inline bool bitboardEmpty(const bitboard_t *board) {
+  uint16_t any = 0;
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    any |= board->rows[row];
+  }
+  return any == 0;
+}
+
+static inline uint8_t bitboardCount(const bitboard_t *board) {
+  uint8_t count = 0;
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    count += __builtin_popcount(board->rows[row]);
+  }
+  return count;
+}
+
+/* Column of the lowest set bit; `bits` must not be zero */
+static inline uint8_t bitboardLowest(uint16_t bits) {
+  return __builtin_ctz(bits);
+}
+
+/* Row moved one column right/left; bits falling off the board are lost */
+static inline uint16_t bitboardRowRight(uint16_t bits) {
+  return (bits << 1) & BITBOARD_ROW_MASK;
+}
+
+static inline uint16_t bitboardRowLeft(uint16_t bits) { return bits >> 1; }
+
+/* Drop bits outside of the `mask` rows, eg. validKeyRows */
+static inline void bitboardMask(bitboard_t *board, const uint16_t *mask) {
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    board->rows[row] &= mask[row];
+  }
+}
+
+/* Number of set neighbours (out of 8) of every position, bit-sliced: bit n
+ * of count[k] is bit k of the count at column n. Counts are modulo 8, so 8
+ * reads as 0. */
+void bitboardNeighbours(const bitboard_t *board, bitboard_t count[3]);
+
+/* Positions with at least one set neighbour or set themselves */
+void bitboardDilate(const bitboard_t *board, bitboard_t *out);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef BLEND_INCLUDED
+#define BLEND_INCLUDED
+
+#include "light_utils.h"
+#include "miniLib8tion.h"
+
+#define RGB_MASK 0x00FFFFFFu
+
+/*
+ * Blending kernels. They work on whole packed 0x00RRGGBB pixels, handling
+ * the channels with SWAR tricks where the math allows it.
+ */
+
+/* Per-channel saturating add: sum of the low 7 bits, then carries out of the
+ * top bit of each channel turn into 0xFF. */
+static inline uint32_t blendAdd(uint32_t a, uint32_t b) {
+  const uint32_t s = (a & 0x7F7F7F) + (b & 0x7F7F7F);
+  const uint32_t carry = ((a & b) | ((a | b) & s)) & 0x808080;
+  const uint32_t sum = (s & 0x7F7F7F) | ((a ^ b ^ s) & 0x808080);
+  return sum | ((carry >> 7) * 0xFF);
+}
+
+static inline uint32_t blendMultiply(uint32_t a, uint32_t b) {
+  return ((uint32_t)scale8(a >> 16, b >> 16) << 16) |
+         ((uint32_t)scale8(a >> 8, b >> 8) << 8) | scale8(a, b);
+}
+
+/* 1 - (1 - a) * (1 - b) */
+static inline uint32_t blendScreen(uint32_t a, uint32_t b) {
+  return ~blendMultiply(~a, ~b) & RGB_MASK;
+}
+
+static inline uint32_t blendMax(uint32_t a, uint32_t b) {
+  uint32_t result = 0;
+  for (uint8_t shift = 0; shift < 24; shift += 8) {
+    const uint32_t ca = a & (0xFFu << shift);
+    const uint32_t cb = b & (0xFFu << shift);
+    result |= ca > cb ? ca : cb;
+  }
+  return result;
+}
+
+/* Linear interpolation of two pixels; red and blue share one multiply.
+ * Each channel product fits in 16 bits, so the lanes don't overlap. */
+static inline uint32_t blendOpacity(uint32_t dst, uint32_t src,
+                                    uint16_t alpha) {
+  const uint32_t inv = 256 - alpha;
+  const uint32_t rb = ((dst & 0xFF00FF) * inv + (src & 0xFF00FF) * alpha) >> 8;
+  const uint32_t g = ((dst & 0x00FF00) * inv + (src & 0x00FF00) * alpha) >> 8;
+  return (rb & 0xFF00FF) | (g & 0x00FF00);
+}
+
+/* Map 0..255 opacity to the 0..256 blendOpacity alpha, so 255 is exact */
+static inline uint16_t blendAlpha(uint8_t opacity) {
+  return opacity + (opacity >> 7);
+}
+
+#endif
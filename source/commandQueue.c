@@ -0,0 +1,55 @@
+/*
+    ===  commandQueue  ===
+    Lock-free message queue from the protocol thread to the executor.
+*/
+#include "commandQueue.h"
+#include "hal.h"
+#include <string.h>
+
+static message_t pool[COMMAND_QUEUE_SIZE];
+
+/* Free running; head is only written by the producer, tail by the consumer */
+static volatile uint8_t head;
+static volatile uint8_t tail;
+
+uint8_t commandQueueHighWater;
+uint16_t commandQueueOverflows;
+
+uint8_t commandQueueDepth(void) { return (uint8_t)(head - tail); }
+
+bool commandQueuePush(const message_t *msg) {
+  const uint8_t depth = commandQueueDepth();
+  if (depth == COMMAND_QUEUE_SIZE) {
+    if (commandQueueOverflows < UINT16_MAX)
+      commandQueueOverflows++;
+    return false;
+  }
+
+  message_t *slot = &pool[head & (COMMAND_QUEUE_SIZE - 1)];
+  slot->command = msg->command;
+  slot->msgId = msg->msgId;
+  slot->payloadSize = msg->payloadSize;
+  memcpy(slot->payload, msg->payload, msg->payloadSize);
+
+  /* Publish the slot only once it's written */
+  __DMB();
+  head++;
+
+  if (depth + 1 > commandQueueHighWater)
+    commandQueueHighWater = depth + 1;
+  return true;
+}
+
+const message_t *commandQueuePeek(void) {
+  if (head == tail)
+    return NULL;
+  /* Don't read the slot before seeing it published */
+  __DMB();
+  return &pool[tail & (COMMAND_QUEUE_SIZE - 1)];
+}
+
+void commandQueuePop(void) {
+  /* Done reading the slot before it's handed back */
+  __DMB();
+  tail++;
+}
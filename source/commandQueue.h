@@ -0,0 +1,38 @@
+#ifndef COMMAND_QUEUE_INCLUDED
+#define COMMAND_QUEUE_INCLUDED
+
+#include "protocol.h"
+#include <stdbool.h>
+
+/*
+ * Queue of received messages between the protocol thread, which pushes, and
+ * the executor thread, which pops. With a single producer and a single
+ * consumer no locking is needed: each side only moves its own index.
+ *
+ * Messages are copied into a fixed pool of COMMAND_QUEUE_SIZE slots (a power
+ * of two), so views into the receive buffer can be queued too. The default
+ * takes a whole frame of row updates (5 rows) without waiting.
+ */
+
+#ifndef COMMAND_QUEUE_SIZE
+#define COMMAND_QUEUE_SIZE 8
+#endif
+
+/* Most messages ever waiting at once */
+extern uint8_t commandQueueHighWater;
+
+/* Messages refused because the queue was full, saturating */
+extern uint16_t commandQueueOverflows;
+
+/* Messages waiting */
+uint8_t commandQueueDepth(void);
+
+/* Producer: copy a message in. Returns false when the queue is full. */
+bool commandQueuePush(const message_t *msg);
+
+/* Consumer: the oldest message, or NULL when empty. It stays valid until
+ * commandQueuePop. */
+const message_t *commandQueuePeek(void);
+void commandQueuePop(void);
+
+#endif
@@ -1,32 +1,197 @@
 #include "commands.h"
 #include "board.h"
+#include "commandQueue.h"
+#include "effectVM.h"
+#include "frameUpload.h"
+#include "governor.h"
+#include "hal.h"
+#include "keystate.h"
+#include "layers.h"
+#include "link.h"
 #include "matrix.h"
 #include "miniFastLED.h"
+#include "palette.h"
 #include "profiles.h"
 #include "protocol.h"
 #include "settings.h"
+#include "text.h"
+#include "transition.h"
 #include <string.h>
 
+/* Commands the executor rejected as malformed. Kept apart from proto.errors,
+ * which belongs to the protocol thread and feeds the link fallback. */
+static uint8_t commandErrors;
+
 /*
  * Reactive profiles are profiles which react to keypresses.
  * This helper is used to notify the main controller that
  * the current profile is reactive and coordinates of pressed
  * keys should be sent to LED controller.
  */
-static inline void sendStatus(void) {
-  uint8_t isReactive = profiles[currentProfile].keypressCallback != NULL &&
+#define STATUS_SIZE 7
+static inline void statusPayload(uint8_t *payload) {
+  uint8_t isReactive = (profiles[currentProfile].keypressCallback != NULL ||
+                        layersReactive()) &&
     !manualControl &&
     !backlightDisabled;
 
-  uint8_t payload[] = {
-      amountOfProfiles, currentProfile, matrixEnabled,
-      isReactive,       ledIntensity,   proto.errors,
-  };
-  protoTx(CMD_LED_STATUS, payload, sizeof(payload), 3);
+  payload[0] = amountOfProfiles;
+  payload[1] = currentProfile;
+  payload[2] = matrixEnabled;
+  payload[3] = isReactive;
+  payload[4] = ledIntensity;
+  payload[5] = proto.errors;
+  payload[6] = commandErrors;
+}
+
+static THD_WORKING_AREA(waExecutor, 256);
+static thread_t *executor;
+
+/* Executor stack never used so far, in bytes: the working area is filled
+ * with CH_DBG_STACK_FILL_VALUE when the thread is created and the stack grows
+ * down towards its base */
+static inline uint16_t executorStackFree(void) {
+  const uint8_t *base = (const uint8_t *)waExecutor;
+  uint16_t unused = 0;
+  while (unused < sizeof(waExecutor) &&
+         base[unused] == CH_DBG_STACK_FILL_VALUE) {
+    unused++;
+  }
+  return unused;
+}
+
+/* Frame render cost, keypress latency, governor state, RX statistics,
+ * executor stack headroom, command queue overflows and effect VM faults */
+#define PERF_SIZE 31
+static inline void perfPayload(uint8_t *payload) {
+  const uint32_t cost = frameCost;
+  const uint32_t costMax = frameCostMax;
+  const uint32_t latency = keyLatency;
+  const uint32_t latencyMax = keyLatencyMax;
+  const uint16_t overruns = frameOverruns;
+  const uint16_t rxOverruns = linkOverruns;
+  const uint16_t dropped = framesDropped;
+  const uint16_t stackFree = executorStackFree();
+  const uint16_t queueOverflows = commandQueueOverflows;
+  memset(payload, 0, PERF_SIZE);
+
+  /* Little endian */
+  for (uint8_t i = 0; i < 4; i++) {
+    payload[i] = cost >> (8 * i);
+    payload[4 + i] = costMax >> (8 * i);
+    payload[9 + i] = latency >> (8 * i);
+    payload[13 + i] = latencyMax >> (8 * i);
+  }
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    payload[8] += layers[i].enabled;
+  }
+  payload[17] = overruns & 0xFF;
+  payload[18] = overruns >> 8;
+  payload[19] = governorLevel;
+  payload[20] = rxOverruns & 0xFF;
+  payload[21] = rxOverruns >> 8;
+  payload[22] = commandQueueDepth();
+  payload[23] = commandQueueHighWater;
+  payload[24] = dropped & 0xFF;
+  payload[25] = dropped >> 8;
+  payload[26] = stackFree & 0xFF;
+  payload[27] = stackFree >> 8;
+  payload[28] = queueOverflows & 0xFF;
+  payload[29] = queueOverflows >> 8;
+  payload[30] = vmFaults;
+}
+
+/*
+ * Replies are sent by the protocol thread once the serial queue has room for
+ * them, so sending never blocks command execution or reception. Lower bits go
+ * first. The status and perf replies are built when sent, so a reply requested
+ * again before that goes out once, with the latest state.
+ */
+enum { REPLY_STATUS = 0x01, REPLY_PERF = 0x02, REPLY_DEBUG = 0x04 };
+static volatile uint8_t repliesPending;
+
+/* Room left in the serial queue for ACKs */
+#define REPLY_RESERVE 8
+
+/* Otherwise the longest replies would never fit */
+_Static_assert(SERIAL_BUFFERS_SIZE >= MAX_PAYLOAD_SIZE + 6 + REPLY_RESERVE,
+               "Serial buffers don't fit a whole frame");
+
+static uint8_t debugPayload[MAX_PAYLOAD_SIZE];
+static uint8_t debugSize;
+
+static thread_t *protocolThread;
+
+static void queueReply(uint8_t reply) {
+  chSysLock();
+  repliesPending |= reply;
+  chSysUnlock();
+  chEvtSignal(protocolThread, LINK_EVENT);
 }
 
+/* The status is queued once the whole message is handled */
+static bool statusRequested;
+
+static inline void requestStatus(void) { statusRequested = true; }
+
 void sendDebug(const char *payload, uint8_t size) {
-  protoTx(CMD_LED_DEBUG, (unsigned char *)payload, size, 1);
+  /* Dropped while the previous one waits */
+  if (size > MAX_PAYLOAD_SIZE || (repliesPending & REPLY_DEBUG))
+    return;
+  memcpy(debugPayload, payload, size);
+  debugSize = size;
+  queueReply(REPLY_DEBUG);
+}
+
+/* Bytes the serial queue takes without blocking */
+static inline size_t txRoom(void) {
+  chSysLock();
+  const size_t room = oqGetEmptyI(&PROTOCOL_SD.oqueue);
+  chSysUnlock();
+  return room;
+}
+
+void commandsSendReplies(void) {
+  while (repliesPending) {
+    /* Lowest bit */
+    const uint8_t reply = repliesPending & -repliesPending;
+    uint8_t size = debugSize;
+    uint8_t copies = 1;
+    if (reply == REPLY_STATUS) {
+      size = STATUS_SIZE;
+      copies = 3;
+    } else if (reply == REPLY_PERF) {
+      size = PERF_SIZE;
+    }
+
+    /* Header and CRC; protoTx repeats messages without ACKs */
+    const uint8_t frames = (proto.features & PROTO_FEATURE_CRC) ? 1 : copies;
+    if (txRoom() < frames * (size + 6u) + REPLY_RESERVE)
+      return;
+
+    if (reply == REPLY_DEBUG) {
+      protoTx(CMD_LED_DEBUG, debugPayload, size, copies);
+      /* Only now the buffer can be reused */
+      chSysLock();
+      repliesPending &= ~reply;
+      chSysUnlock();
+      continue;
+    }
+
+    /* Requests from now on need another reply */
+    chSysLock();
+    repliesPending &= ~reply;
+    chSysUnlock();
+
+    uint8_t payload[PERF_SIZE];
+    if (reply == REPLY_STATUS) {
+      statusPayload(payload);
+      protoTx(CMD_LED_STATUS, payload, size, copies);
+    } else {
+      perfPayload(payload);
+      protoTx(CMD_LED_PERF, payload, size, copies);
+    }
+  }
 }
 
 static inline void setIAP(void) {
@@ -40,24 +205,97 @@ static inline void setIAP(void) {
 /*
  * Execute current profile
  */
-static inline void executeProfile(bool init) {
+/* Zero the profile state and let the profile initialize it. Called with the
+ * system locked, so the PWM interrupt can't render a half-initialized state.
+ */
+static inline void resetProfile(void) {
   profile_init pinit = profiles[currentProfile].profileInit;
-  if (init && pinit != NULL) {
+  resetProfileState();
+  if (pinit != NULL) {
     pinit(ledColors);
   }
+}
+
+/* Profile changes are applied by the PWM interrupt on frame boundary, in
+ * between two frames, rather than holding the system locked from the
+ * executor for a whole profile initialization. */
+enum { PROFILE_KEEP, PROFILE_RESET, PROFILE_SWITCH };
+static volatile uint8_t profileChange = PROFILE_KEEP;
+static uint8_t profileChangeTarget;
+
+/* Frames come every 14ms; without one the matrix was just turned off */
+#define PROFILE_CHANGE_TIMEOUT_MS 50
+
+/* Called with the system locked */
+static void profileChangeApplyI(void) {
+  if (profileChange == PROFILE_SWITCH) {
+    const bool resume = transitionBegin(profileChangeTarget);
+    keysReleaseAll();
+    governorReset();
+    currentProfile = profileChangeTarget;
+    if (!resume) {
+      resetProfile();
+    }
+  } else if (profileChange == PROFILE_RESET) {
+    resetProfile();
+  }
+  profileChange = PROFILE_KEEP;
+}
+
+/* Hand a profile change over to the PWM interrupt and wait until it's
+ * applied, so the following commands see the new profile */
+static void changeProfile(uint8_t change, uint8_t profile) {
+  chSysLock();
+  chEvtGetAndClearEventsI(PROFILE_APPLIED);
+  profileChange = change;
+  profileChangeTarget = profile;
+  /* No frames are rendered, nothing to wait for */
+  if (!matrixEnabled)
+    profileChangeApplyI();
+  chSysUnlock();
+
+  if (chEvtWaitAnyTimeout(PROFILE_APPLIED,
+                          TIME_MS2I(PROFILE_CHANGE_TIMEOUT_MS)) == 0) {
+    chSysLock();
+    if (profileChange != PROFILE_KEEP)
+      profileChangeApplyI();
+    chEvtGetAndClearEventsI(PROFILE_APPLIED);
+    chSysUnlock();
+  }
+}
+
+static inline void executeProfile(bool init) {
+  if (init) {
+    changeProfile(PROFILE_RESET, currentProfile);
+  }
 
   updateAnimationSpeed();
 
   needToCallbackProfile = true;
 }
 
+/* Switch to a new profile, fading out the previous one. The profile resumes
+ * if it was the one left last, otherwise it's initialized. */
+static inline void switchProfile(uint8_t profile) {
+  changeProfile(PROFILE_SWITCH, profile);
+  executeProfile(false);
+}
+
 static inline void nextIntensity(void) {
   ledIntensity = (ledIntensity + 1) % 8;
+  /* The palette table is stored dimmed */
+  paletteExpand();
   executeProfile(false);
 }
 
+/* Step through the four profile speeds */
 static inline void nextSpeed(void) {
-  currentSpeed = (currentSpeed + 1) % 4;
+  currentSpeed = currentSpeed >= 255 ? 0 : (currentSpeed / 85 + 1) * 85;
+  updateAnimationSpeed();
+}
+
+static inline void setSpeed(uint8_t speed) {
+  currentSpeed = speed;
   updateAnimationSpeed();
 }
 
@@ -70,10 +308,35 @@ static inline void nextSpeed(void) {
 static inline void handleKeypress(uint8_t command) {
   uint8_t row = (command >> 4) & 0b111;
   uint8_t col = command & 0b1111;
-  keypress_handler handler = profiles[currentProfile].keypressCallback;
-  if (handler != NULL && row < NUM_ROW && col < NUM_COLUMN) {
-    handler(ledColors, row, col);
-  }
+  if (row >= NUM_ROW || col >= NUM_COLUMN)
+    return;
+
+  /* Handlers are run by the PWM interrupt, in between two columns */
+  chSysLock();
+  keyDown(row, col);
+  matrixKeyPressI(row, col);
+  chSysUnlock();
+}
+
+/* Same encoding as handleKeypress */
+static inline void handleKeyRelease(uint8_t command) {
+  uint8_t row = (command >> 4) & 0b111;
+  uint8_t col = command & 0b1111;
+  if (row >= NUM_ROW || col >= NUM_COLUMN)
+    return;
+
+  chSysLock();
+  keyUp(row, col);
+  chSysUnlock();
+}
+
+/* Profile `step` places from the current one among the cycled profiles.
+ * From an explicitly selected upload profile, cycling starts over. */
+static inline uint8_t cycledProfile(int8_t step) {
+  const uint8_t count = amountOfCycledProfiles;
+  if (currentProfile >= count)
+    return step > 0 ? 0 : count - 1;
+  return (currentProfile + count + step) % count;
 }
 
 /*
@@ -81,8 +344,7 @@ static inline void handleKeypress(uint8_t command) {
  */
 static inline void setProfile(uint8_t profile) {
   if (profile < amountOfProfiles) {
-    currentProfile = profile;
-    executeProfile(true);
+    switchProfile(profile);
   }
 }
 
@@ -213,11 +475,76 @@ static inline void setColorMono(const message_t *msg) {
   setLedMono(ledColors, msg);
 }
 
+/* Effect VM upload: offset followed by the program bytes */
+static inline void vmLoadChunk(const message_t *msg) {
+  if (msg->payloadSize < 1 ||
+      !vmLoad(msg->payload[0], &msg->payload[1], msg->payloadSize - 1))
+    commandErrors++;
+}
+
+static inline void vmCommitProgram(const message_t *msg) {
+  if (!vmCommit(msg->payload[0]))
+    commandErrors++;
+  needToCallbackProfile = true;
+}
+
+/* Gradient palettes */
+static inline void setPalette(const message_t *msg) {
+  if (!paletteSelect(msg->payload[0]))
+    commandErrors++;
+  needToCallbackProfile = true;
+}
+
+static inline void uploadPalette(const message_t *msg) {
+  if (!paletteUpload(msg->payload, msg->payloadSize))
+    commandErrors++;
+  needToCallbackProfile = true;
+}
+
+/* Effect layers */
+static inline void setLayer(const message_t *msg) {
+  if (msg->payloadSize < 5 ||
+      !layerSet(msg->payload[0], msg->payload[1], msg->payload[2],
+                msg->payload[3], msg->payload[4]))
+    commandErrors++;
+}
+
+static inline uint8_t findProfile(lighting_callback callback) {
+  uint8_t i = 0;
+  while (i < amountOfProfiles && profiles[i].callback != callback)
+    i++;
+  return i;
+}
+
+static inline void scrollText(const message_t *msg) {
+  const uint8_t *p = msg->payload;
+  if (msg->payloadSize < 9) {
+    commandErrors++;
+    return;
+  }
+
+  const uint32_t fg = p[3] | (p[4] << 8) | (p[5] << 16);
+  const uint32_t bg = p[6] | (p[7] << 8) | (p[8] << 16);
+  if (!textScrollSet((const char *)&p[9], msg->payloadSize - 9, fg, bg) ||
+      !layerSet(p[0], findProfile(textScroll), p[1], 255, p[2]))
+    commandErrors++;
+}
+
+static inline void clearLayer(const message_t *msg) {
+  if (msg->payload[0] == 0xFF) {
+    for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+      layerClear(i);
+    }
+  } else {
+    layerClear(msg->payload[0]);
+  }
+}
+
 static inline void handleStickyEnabled(void) {
   stickyKeysExist = 1;
   if (!matrixEnabled) {
     matrixEnable();
-    sendStatus();
+    requestStatus();
     // we changed backlightDisabled by calling matrixEnable
     // we must set it to 1 as the user wants backlight
     // to be off
@@ -255,7 +582,7 @@ static inline void checkStickyExists(void) {
     // matrix was enabled by sticky keys but disabled
     // by user, we should disable it again
     matrixDisable();
-    sendStatus();
+    requestStatus();
   }
 }
 
@@ -294,39 +621,43 @@ static inline void unsetStickyAll(void) {
  * refreshing algorithm. Keep it simple, fast, mark something in a variable
  * and do the rest in another thread.
  */
-void commandCallback(const message_t *msg) {
+static void executeCommand(const message_t *msg) {
   switch (msg->command) {
   case CMD_LED_ON:
     executeProfile(true);
     matrixEnable();
-    sendStatus();
+    requestStatus();
     break;
   case CMD_LED_OFF:
     matrixDisable();
-    sendStatus();
+    requestStatus();
     break;
   case CMD_LED_SET_PROFILE:
     setProfile(msg->payload[0]);
-    sendStatus();
+    requestStatus();
     break;
   case CMD_LED_NEXT_PROFILE:
-    currentProfile = (currentProfile + 1) % amountOfProfiles;
-    executeProfile(true);
-    sendStatus();
+    switchProfile(cycledProfile(1));
+    requestStatus();
     break;
   case CMD_LED_PREV_PROFILE:
-    currentProfile =
-        (currentProfile + (amountOfProfiles - 1u)) % amountOfProfiles;
-    executeProfile(true);
-    sendStatus();
+    switchProfile(cycledProfile(-1));
+    requestStatus();
     break;
   case CMD_LED_NEXT_INTENSITY:
     nextIntensity();
-    sendStatus();
+    requestStatus();
     break;
   case CMD_LED_NEXT_ANIMATION_SPEED:
     nextSpeed();
-    sendStatus();
+    requestStatus();
+    break;
+  case CMD_LED_SET_ANIMATION_SPEED:
+    setSpeed(msg->payload[0]);
+    requestStatus();
+    break;
+  case CMD_LED_SET_TRANSITION:
+    transitionFrames = msg->payload[0];
     break;
   case CMD_LED_IAP:
     setIAP();
@@ -335,6 +666,12 @@ void commandCallback(const message_t *msg) {
   case CMD_LED_KEY_DOWN:
     handleKeypress(msg->payload[0]);
     break;
+  case CMD_LED_KEY_UP:
+    handleKeyRelease(msg->payload[0]);
+    break;
+  case CMD_LED_GET_PERF:
+    queueReply(REPLY_PERF);
+    break;
 
   /* Handle masking */
   case CMD_LED_MASK_SET_KEY:
@@ -353,7 +690,7 @@ void commandCallback(const message_t *msg) {
   /* Handle manual color control */
   case CMD_LED_SET_MANUAL:
     setManual(msg);
-    sendStatus();
+    requestStatus();
     break;
   case CMD_LED_COLOR_SET_KEY:
     setColorKey(msg);
@@ -385,8 +722,146 @@ void commandCallback(const message_t *msg) {
     unsetStickyAll();
     break;
 
+  /* Handle effect VM upload */
+  case CMD_LED_VM_LOAD:
+    vmLoadChunk(msg);
+    break;
+  case CMD_LED_VM_COMMIT:
+    vmCommitProgram(msg);
+    requestStatus();
+    break;
+
+  /* Handle effect layers */
+  case CMD_LED_LAYER_SET:
+    setLayer(msg);
+    requestStatus();
+    break;
+  case CMD_LED_LAYER_CLEAR:
+    clearLayer(msg);
+    requestStatus();
+    break;
+  case CMD_LED_TEXT_SCROLL:
+    scrollText(msg);
+    requestStatus();
+    break;
+
+  /* Handle gradient palettes */
+  case CMD_LED_SET_PALETTE:
+    setPalette(msg);
+    break;
+  case CMD_LED_PALETTE_UPLOAD:
+    uploadPalette(msg);
+    break;
+
+  /* Only buffered; the PWM interrupt shows complete frames */
+  case CMD_LED_FRAME_FRAGMENT:
+    if (!frameUploadFragment(msg->payload, msg->payloadSize))
+      commandErrors++;
+    break;
+
   default:
-    proto.errors++;
+    commandErrors++;
     break;
   }
 }
+
+/* Entries of a batch are unpacked here one by one */
+static message_t batchEntry;
+
+static void executeBatch(const message_t *msg) {
+  const uint8_t *p = msg->payload;
+  const uint8_t *const end = p + msg->payloadSize;
+
+  batchEntry.command = 0;
+  batchEntry.msgId = msg->msgId;
+  while (p < end) {
+    if (*p & 0x80) {
+      /* Same command as the previous entry */
+      batchEntry.payloadSize = *p++ & 0x7F;
+    } else if (end - p >= 2) {
+      batchEntry.command = *p++;
+      batchEntry.payloadSize = *p++;
+    } else {
+      commandErrors++;
+      return;
+    }
+
+    if (batchEntry.payloadSize > end - p ||
+        batchEntry.command == CMD_LED_BATCH) {
+      commandErrors++;
+      return;
+    }
+    memcpy(batchEntry.payload, p, batchEntry.payloadSize);
+    p += batchEntry.payloadSize;
+    executeCommand(&batchEntry);
+  }
+}
+
+static void executeMessage(const message_t *msg) {
+  if (msg->command == CMD_LED_BATCH) {
+    executeBatch(msg);
+  } else {
+    executeCommand(msg);
+  }
+
+  /* Once per batch */
+  if (statusRequested) {
+    statusRequested = false;
+    queueReply(REPLY_STATUS);
+  }
+}
+
+/* Apply queued messages when woken up */
+static THD_FUNCTION(executorFun, arg) {
+  (void)arg;
+  chRegSetThreadName("executor");
+
+  while (true) {
+    chEvtWaitAny(EXECUTOR_WAKEUP);
+    const message_t *msg;
+    while ((msg = commandQueuePeek()) != NULL) {
+      executeMessage(msg);
+      commandQueuePop();
+    }
+  }
+}
+
+void commandsInit(void) {
+  protocolThread = chThdGetSelfX();
+  executor = chThdCreateStatic(waExecutor, sizeof(waExecutor), NORMALPRIO + 1,
+                               executorFun, NULL);
+}
+
+bool commandCallback(const message_t *msg) {
+  switch (msg->command) {
+  /* Link negotiation restarts the serial driver under the protocol thread */
+  case CMD_LED_LINK_HELLO:
+    linkHello(msg);
+    return true;
+  }
+
+  /* Not acknowledged, the main MCU sends it again */
+  if (!commandQueuePush(msg)) {
+    chEvtSignal(executor, EXECUTOR_WAKEUP);
+    return false;
+  }
+
+  /* Keypresses are shown right away, the rest waits for the frame boundary -
+   * unless the matrix is off and there are no frames, or a burst fills the
+   * queue. Frame fragments come in bursts, so they are buffered right away. */
+  if (msg->command == CMD_LED_KEY_DOWN || msg->command == CMD_LED_KEY_UP ||
+      msg->command == CMD_LED_BATCH ||
+      msg->command == CMD_LED_FRAME_FRAGMENT || !matrixEnabled ||
+      commandQueueDepth() > COMMAND_QUEUE_SIZE / 2)
+    chEvtSignal(executor, EXECUTOR_WAKEUP);
+  return true;
+}
+
+void commandsFrameI(void) {
+  if (profileChange != PROFILE_KEEP) {
+    profileChangeApplyI();
+    chEvtSignalI(executor, PROFILE_APPLIED);
+  }
+  if (commandQueueDepth() > 0)
+    chEvtSignalI(executor, EXECUTOR_WAKEUP);
+}
@@ -1,13 +1,39 @@
 #ifndef COMMANDS_INCLUDED
 #define COMMANDS_INCLUDED
 
+#include "ch.h"
 #include "protocol.h"
 
-/* Called as a protocol callback to handle incoming messages */
-extern void commandCallback(const message_t *msg);
+/*
+ * Received messages are queued by the protocol thread (commandQueue.h) and
+ * applied by the executor thread, so reception never waits for a command.
+ * Queued messages are applied at the next frame boundary; keypresses and
+ * batches, which may carry them, right away.
+ */
+
+/* Wakes up the executor */
+#define EXECUTOR_WAKEUP EVENT_MASK(0)
+
+/* A profile change was applied on frame boundary */
+#define PROFILE_APPLIED EVENT_MASK(1)
+
+/* Start the executor thread; called by the protocol thread */
+extern void commandsInit(void);
+
+/* Called as a protocol callback to handle incoming messages. Returns false
+ * when the command queue is full. */
+extern bool commandCallback(const message_t *msg);
+
+/* Frame boundary, called from the PWM interrupt with the system locked */
+extern void commandsFrameI(void);
 
 /* Send arbitrary data to the main chip, which can transmit them over USB to PC
- * for debugging. */
+ * for debugging. Queued behind status replies; dropped while the previous
+ * one still waits. */
 extern void sendDebug(const char *payload, uint8_t size);
 
+/* Send queued replies the serial queue has room for. Called by the protocol
+ * thread, which is woken up with LINK_EVENT when a reply is queued. */
+extern void commandsSendReplies(void);
+
 #endif
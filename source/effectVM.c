@@ -0,0 +1,314 @@
+/*
+    ===  effectVM  ===
+    Interpreter for effects uploaded by the main MCU at runtime.
+*/
+#include "effectVM.h"
+#include "ch.h"
+#include "matrix.h"
+#include "miniFastLED.h"
+#include "miniLib8tion.h"
+#include "string.h"
+
+/* Opcode metadata: immediate bytes, popped and pushed values */
+typedef struct {
+  uint8_t imm : 2;
+  uint8_t pops : 3;
+  uint8_t pushes : 3;
+} vm_op_info;
+
+static const vm_op_info opInfo[VM_OPCODE_COUNT] = {
+    [VM_END] = {0, 0, 0},    [VM_PUSH8] = {1, 0, 1},  [VM_PUSH16] = {2, 0, 1},
+    [VM_ROW] = {0, 0, 1},    [VM_COL] = {0, 0, 1},    [VM_TIME] = {0, 0, 1},
+    [VM_DUP] = {0, 1, 2},    [VM_DROP] = {0, 1, 0},   [VM_SWAP] = {0, 2, 2},
+    [VM_OVER] = {0, 2, 3},   [VM_ADD] = {0, 2, 1},    [VM_SUB] = {0, 2, 1},
+    [VM_MUL] = {0, 2, 1},    [VM_SCALE8] = {0, 2, 1}, [VM_SHR] = {0, 2, 1},
+    [VM_SHL] = {0, 2, 1},    [VM_AND] = {0, 2, 1},    [VM_OR] = {0, 2, 1},
+    [VM_XOR] = {0, 2, 1},    [VM_MIN] = {0, 2, 1},    [VM_MAX] = {0, 2, 1},
+    [VM_SIN8] = {0, 1, 1},   [VM_COS8] = {0, 1, 1},   [VM_TRI8] = {0, 1, 1},
+    [VM_EASE8] = {0, 1, 1},  [VM_NOISE] = {0, 2, 1},  [VM_RAND8] = {0, 0, 1},
+    [VM_LOAD] = {1, 0, 1},   [VM_STORE] = {1, 1, 0},  [VM_JMP] = {1, 0, 0},
+    [VM_JZ] = {1, 1, 0},     [VM_HSV] = {0, 3, 0},    [VM_RGB] = {0, 3, 0},
+};
+
+/* One spare byte so there is always a VM_END behind the program */
+static uint8_t program[VM_MAX_PROGRAM + 1];
+/* Written by the executor, read by the PWM interrupt; see publish */
+static volatile bool programValid = false;
+/* Bumped on each commit, so running VM state gets reset */
+static volatile uint8_t programGeneration = 0;
+
+uint8_t vmFaults = 0;
+
+/* Stop the PWM interrupt running the program, or let it run a committed one.
+ * The lock orders the program bytes against the flag. */
+static inline void publish(bool valid) {
+  chSysLock();
+  if (valid)
+    programGeneration++;
+  programValid = valid;
+  chSysUnlock();
+}
+
+/* Programs come from the host, so the arithmetic wraps around instead of
+ * overflowing, and shifts are defined for negative values too. */
+static inline int32_t wrap(uint32_t v) { return (int32_t)v; }
+
+static inline int32_t shiftRight(int32_t v, uint32_t n) {
+  n &= 31;
+  return v < 0 ? ~wrap(~(uint32_t)v >> n) : wrap((uint32_t)v >> n);
+}
+
+static inline uint8_t clamp8(int32_t v) {
+  if (v < 0)
+    return 0;
+  if (v > 255)
+    return 255;
+  return v;
+}
+
+bool vmLoad(uint8_t offset, const uint8_t *code, uint8_t size) {
+  publish(false);
+  if ((uint16_t)offset + size > VM_MAX_PROGRAM)
+    return false;
+  memcpy(&program[offset], code, size);
+  return true;
+}
+
+bool vmCommit(uint8_t size) {
+  uint16_t instructions = 0;
+  uint8_t pc = 0;
+
+  publish(false);
+  if (size == 0 || size > VM_MAX_PROGRAM)
+    return false;
+
+  while (pc < size) {
+    const uint8_t op = program[pc];
+    if (op >= VM_OPCODE_COUNT)
+      return false;
+    const uint8_t next = pc + 1 + opInfo[op].imm;
+    if (next > size)
+      return false;
+
+    switch (op) {
+    case VM_LOAD:
+    case VM_STORE:
+      if (program[pc + 1] >= VM_VARIABLES)
+        return false;
+      break;
+    case VM_JMP:
+    case VM_JZ:
+      /* Forward only; may jump right behind the last instruction */
+      if (next + program[pc + 1] > size)
+        return false;
+      break;
+    }
+    instructions++;
+    pc = next;
+  }
+
+  /* Without backward jumps each instruction runs at most once per key */
+  if (instructions * KEY_COUNT > VM_FRAME_BUDGET)
+    return false;
+
+  /* Running over the end is an implicit VM_END */
+  program[size] = VM_END;
+
+  publish(true);
+  return true;
+}
+
+void vmReset(vm_state_t *vm) {
+  memset(vm, 0, sizeof(*vm));
+  vm->generation = programGeneration;
+}
+
+/* Execute the program for a single key. Returns number of executed
+ * instructions or 0 on fault. */
+static uint16_t vmRunKey(vm_state_t *vm, led_t *key, uint8_t row,
+                         uint8_t col) {
+  int32_t stack[VM_STACK_SIZE];
+  uint8_t sp = 0;
+  uint8_t pc = 0;
+  uint16_t steps = 0;
+
+/* Top of the stack and the value below it */
+#define TOP stack[sp - 1]
+#define NEXT stack[sp - 2]
+
+  while (pc < VM_MAX_PROGRAM) {
+    const uint8_t op = program[pc];
+    if (op == VM_END)
+      break;
+
+    const vm_op_info info = opInfo[op];
+    if (sp < info.pops || sp - info.pops + info.pushes > VM_STACK_SIZE)
+      return 0;
+
+    const uint8_t imm = program[pc + 1];
+    pc += 1 + info.imm;
+    steps++;
+
+    switch (op) {
+    case VM_PUSH8:
+      stack[sp++] = imm;
+      break;
+    case VM_PUSH16:
+      stack[sp++] = (int16_t)(imm | (program[pc - 1] << 8));
+      break;
+    case VM_ROW:
+      stack[sp++] = row;
+      break;
+    case VM_COL:
+      stack[sp++] = col;
+      break;
+    case VM_TIME:
+      stack[sp++] = vm->frame;
+      break;
+
+    case VM_DUP:
+      stack[sp] = TOP;
+      sp++;
+      break;
+    case VM_DROP:
+      sp--;
+      break;
+    case VM_SWAP: {
+      const int32_t t = TOP;
+      TOP = NEXT;
+      NEXT = t;
+      break;
+    }
+    case VM_OVER:
+      stack[sp] = NEXT;
+      sp++;
+      break;
+
+    /* Binary operations: b = b OP a */
+    case VM_ADD:
+      NEXT = wrap((uint32_t)NEXT + (uint32_t)TOP);
+      sp--;
+      break;
+    case VM_SUB:
+      NEXT = wrap((uint32_t)NEXT - (uint32_t)TOP);
+      sp--;
+      break;
+    case VM_MUL:
+      NEXT = wrap((uint32_t)NEXT * (uint32_t)TOP);
+      sp--;
+      break;
+    case VM_SCALE8:
+      NEXT = shiftRight(wrap((uint32_t)NEXT * (uint32_t)TOP), 8);
+      sp--;
+      break;
+    case VM_SHR:
+      NEXT = shiftRight(NEXT, TOP);
+      sp--;
+      break;
+    case VM_SHL:
+      NEXT = wrap((uint32_t)NEXT << ((uint32_t)TOP & 31));
+      sp--;
+      break;
+    case VM_AND:
+      NEXT &= TOP;
+      sp--;
+      break;
+    case VM_OR:
+      NEXT |= TOP;
+      sp--;
+      break;
+    case VM_XOR:
+      NEXT ^= TOP;
+      sp--;
+      break;
+    case VM_MIN:
+      if (TOP < NEXT)
+        NEXT = TOP;
+      sp--;
+      break;
+    case VM_MAX:
+      if (TOP > NEXT)
+        NEXT = TOP;
+      sp--;
+      break;
+
+    case VM_SIN8:
+      TOP = sin8(TOP);
+      break;
+    case VM_COS8:
+      TOP = cos8(TOP);
+      break;
+    case VM_TRI8:
+      TOP = triwave8(TOP);
+      break;
+    case VM_EASE8:
+      TOP = ease8InOutCubic(clamp8(TOP));
+      break;
+    case VM_NOISE:
+      NEXT = noise8_2d(NEXT, TOP);
+      sp--;
+      break;
+    case VM_RAND8:
+      stack[sp++] = random8();
+      break;
+
+    case VM_LOAD:
+      stack[sp++] = vm->variables[imm];
+      break;
+    case VM_STORE:
+      vm->variables[imm] = TOP;
+      sp--;
+      break;
+
+    case VM_JMP:
+      pc += imm;
+      break;
+    case VM_JZ:
+      if (TOP == 0)
+        pc += imm;
+      sp--;
+      break;
+
+    case VM_HSV:
+      hsv2rgb(stack[sp - 3], clamp8(NEXT), clamp8(TOP), key);
+      sp -= 3;
+      break;
+    case VM_RGB:
+      key->p.red = clamp8(stack[sp - 3]);
+      key->p.green = clamp8(NEXT);
+      key->p.blue = clamp8(TOP);
+      naiveDimLed(key);
+      sp -= 3;
+      break;
+    }
+  }
+#undef TOP
+#undef NEXT
+  return steps ? steps : 1;
+}
+
+void vmRender(vm_state_t *vm, led_t *ledColors) {
+  uint16_t budget = VM_FRAME_BUDGET;
+
+  if (!programValid) {
+    setAllKeysToBlank(ledColors);
+    return;
+  }
+  if (vm->generation != programGeneration)
+    vmReset(vm);
+
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint8_t col = 0; col < NUM_COLUMN; col++) {
+      const uint16_t steps =
+          vmRunKey(vm, &ledColors[ROWCOL2IDX(row, col)], row, col);
+      if (steps == 0 || steps > budget) {
+        /* Broken program - stop running it */
+        vmFaults++;
+        programValid = false;
+        return;
+      }
+      budget -= steps;
+    }
+  }
+  vm->frame++;
+}
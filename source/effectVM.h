@@ -0,0 +1,100 @@
+#ifndef EFFECTVM_INCLUDED
+#define EFFECTVM_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * Tiny stack machine for effects uploaded over the protocol.
+ *
+ * The program is run once for every key on each animation frame and paints
+ * that key with VM_HSV or VM_RGB. Values are 32-bit integers which wrap
+ * around on overflow, shift counts are taken modulo 32; the math opcodes
+ * follow miniLib8tion conventions (0..255 is one turn or 0.0..1.0).
+ *
+ * Jumps can only go forward, so the worst case cost of a program is its
+ * instruction count times KEY_COUNT. vmCommit rejects programs which could
+ * exceed VM_FRAME_BUDGET, so an uploaded effect can't starve the PWM ISR;
+ * that is at most 29 instructions. A program which faults at runtime is
+ * stopped and counted in vmFaults, reported by CMD_LED_PERF.
+ *
+ * Keep the opcode list in sync with tools/vmasm.py.
+ */
+
+/* Maximal program size in bytes */
+#define VM_MAX_PROGRAM 128
+
+/* Maximal number of instructions executed in a single frame (all keys) */
+#define VM_FRAME_BUDGET 2048
+
+#define VM_STACK_SIZE 8
+#define VM_VARIABLES 8
+
+typedef enum {
+  VM_END = 0x00, /* Finish current key */
+
+  VM_PUSH8 = 0x01,  /* imm8 */
+  VM_PUSH16 = 0x02, /* imm16, little endian, sign extended */
+  VM_ROW = 0x03,    /* Row of the rendered key */
+  VM_COL = 0x04,    /* Column of the rendered key */
+  VM_TIME = 0x05,   /* Frames since profile init */
+
+  VM_DUP = 0x06,
+  VM_DROP = 0x07,
+  VM_SWAP = 0x08,
+  VM_OVER = 0x09,
+
+  VM_ADD = 0x0A,
+  VM_SUB = 0x0B,
+  VM_MUL = 0x0C,
+  VM_SCALE8 = 0x0D, /* a * b / 256 */
+  VM_SHR = 0x0E,
+  VM_SHL = 0x0F,
+  VM_AND = 0x10,
+  VM_OR = 0x11,
+  VM_XOR = 0x12,
+  VM_MIN = 0x13,
+  VM_MAX = 0x14,
+
+  VM_SIN8 = 0x15,
+  VM_COS8 = 0x16,
+  VM_TRI8 = 0x17,
+  VM_EASE8 = 0x18,  /* Cubic ease in/out */
+  VM_NOISE = 0x19,  /* x y -> noise8_2d(x, y) */
+  VM_RAND8 = 0x1A,
+
+  VM_LOAD = 0x1B,  /* imm8 variable index */
+  VM_STORE = 0x1C, /* imm8 variable index */
+
+  VM_JMP = 0x1D, /* imm8 forward offset from the next instruction */
+  VM_JZ = 0x1E,  /* imm8 forward offset, jump if popped value is zero */
+
+  VM_HSV = 0x1F, /* h s v -> paint the key */
+  VM_RGB = 0x20, /* r g b -> paint the key */
+
+  VM_OPCODE_COUNT
+} vm_opcode;
+
+/* Per-profile VM state; lives in the profile state arena */
+typedef struct {
+  int32_t variables[VM_VARIABLES];
+  /* Frames since start and the program this state belongs to */
+  uint16_t frame;
+  uint8_t generation;
+} vm_state_t;
+
+/* Store a part of the program; invalidates the currently loaded one. */
+bool vmLoad(uint8_t offset, const uint8_t *code, uint8_t size);
+
+/* Validate first `size` bytes and enable the program if it's correct. */
+bool vmCommit(uint8_t size);
+
+/* Reset VM variables and frame counter */
+void vmReset(vm_state_t *vm);
+
+/* Render one frame with the loaded program */
+void vmRender(vm_state_t *vm, led_t *ledColors);
+
+/* Number of runtime faults (stack errors, budget overruns), wraps around */
+extern uint8_t vmFaults;
+
+#endif
@@ -0,0 +1,121 @@
+/*
+    ===  frameUpload  ===
+    Reassembles fragmented frames and shows them whole.
+*/
+#include "frameUpload.h"
+#include "ch.h"
+#include "matrix.h"
+#include "miniFastLED.h"
+#include "palette.h"
+#include <string.h>
+
+static const uint8_t bytesPerPixel[FRAME_FORMAT_COUNT] = {3, 2, 1};
+
+static led_t staging[KEY_COUNT];
+
+static struct {
+  uint8_t frame;
+  uint8_t format;
+  /* Bit n - fragment n was stored */
+  uint8_t received;
+  /* All fragments of the frame */
+  uint8_t complete;
+  /* Complete and waiting for the frame boundary */
+  volatile bool ready;
+} upload;
+
+uint16_t framesDropped;
+
+static inline void dropFrame(void) {
+  if (framesDropped < UINT16_MAX)
+    framesDropped++;
+}
+
+static void decode(led_t *out, const uint8_t *in, uint8_t count,
+                   uint8_t format) {
+  for (uint8_t i = 0; i < count; i++) {
+    led_t color = {.rgb = 0};
+    switch (format) {
+    case FRAME_FORMAT_BGR888:
+      color.p.blue = in[0];
+      color.p.green = in[1];
+      color.p.red = in[2];
+      naiveDimLed(&color);
+      break;
+    case FRAME_FORMAT_RGB565: {
+      const uint16_t px = in[0] | (in[1] << 8);
+      const uint8_t r = px >> 11, g = (px >> 5) & 0x3F, b = px & 0x1F;
+      color.p.red = (r << 3) | (r >> 2);
+      color.p.green = (g << 2) | (g >> 4);
+      color.p.blue = (b << 3) | (b >> 2);
+      naiveDimLed(&color);
+      break;
+    }
+    default:
+      /* The palette is stored dimmed */
+      color.rgb = paletteLookup(in[0]);
+      break;
+    }
+    out[i] = color;
+    in += bytesPerPixel[format];
+  }
+}
+
+bool frameUploadFragment(const uint8_t *payload, uint8_t size) {
+  if (size < 3 || payload[1] >= FRAME_FORMAT_COUNT)
+    return false;
+
+  const uint8_t frame = payload[0];
+  const uint8_t format = payload[1];
+  const uint8_t fragment = payload[2];
+  const uint8_t bpp = bytesPerPixel[format];
+  const uint8_t perFragment = FRAME_FRAGMENT_DATA / bpp;
+  const uint8_t fragments = (KEY_COUNT + perFragment - 1) / perFragment;
+  if (fragment >= fragments)
+    return false;
+  const uint8_t complete = (1u << fragments) - 1;
+
+  const uint8_t first = fragment * perFragment;
+  uint8_t count = KEY_COUNT - first;
+  if (count > perFragment)
+    count = perFragment;
+  if (size - 3 < count * bpp)
+    return false;
+
+  chSysLock();
+  if (frame != upload.frame || format != upload.format) {
+    /* A new frame; a pending or partial one won't be shown */
+    if (upload.ready ||
+        (upload.received != 0 && upload.received != upload.complete))
+      dropFrame();
+    upload.ready = false;
+    upload.frame = frame;
+    upload.format = format;
+    upload.received = 0;
+    upload.complete = complete;
+  } else if (upload.ready) {
+    /* A resend of the pending frame */
+    chSysUnlock();
+    return true;
+  }
+  chSysUnlock();
+
+  /* Not ready, so the interrupt doesn't read the staging buffer */
+  decode(&staging[first], &payload[3], count, format);
+  upload.received |= 1u << fragment;
+  if (upload.received == complete) {
+    chSysLock();
+    upload.ready = true;
+    chSysUnlock();
+  }
+  return true;
+}
+
+void frameUploadApply(void) {
+  if (!upload.ready)
+    return;
+  memcpy(ledColors, staging, sizeof(staging));
+  upload.ready = false;
+  /* The next frame may reuse the id */
+  upload.received = 0;
+}
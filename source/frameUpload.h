@@ -0,0 +1,40 @@
+#ifndef FRAME_UPLOAD_INCLUDED
+#define FRAME_UPLOAD_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * Whole frames uploaded by the main MCU (CMD_LED_FRAME_FRAGMENT).
+ *
+ * A frame doesn't fit a single message, so it's sent in fragments of
+ * FRAME_FRAGMENT_DATA bytes of pixels each, which are decoded into a staging
+ * buffer in any order. Once all fragments of a frame arrived, the PWM
+ * interrupt copies it over ledColors on the next frame boundary, so the frame
+ * is never shown half updated. A new frame started before that supersedes
+ * the pending one.
+ */
+
+/* Pixel formats */
+typedef enum {
+  /* B G R, like the other color commands */
+  FRAME_FORMAT_BGR888 = 0,
+  /* 16-bit little endian: 5 bits red, 6 green, 5 blue */
+  FRAME_FORMAT_RGB565,
+  /* Index into the current palette */
+  FRAME_FORMAT_PALETTE,
+  FRAME_FORMAT_COUNT
+} frame_format;
+
+/* Pixel bytes in a fragment, after the frame id, format and fragment index */
+#define FRAME_FRAGMENT_DATA 60
+
+/* Frames which were superseded or left incomplete, saturating */
+extern uint16_t framesDropped;
+
+/* Store a fragment. Returns false if it's malformed. */
+bool frameUploadFragment(const uint8_t *payload, uint8_t size);
+
+/* Called by the PWM interrupt on frame boundary: show a complete frame */
+void frameUploadApply(void);
+
+#endif
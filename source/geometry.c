@@ -0,0 +1,197 @@
+/*
+    ===  geometry  ===
+    Generated by tools/gengeometry.py - do not edit.
+*/
+#include "geometry.h"
+
+// clang-format off
+const uint16_t validKeyRows[5] = {
+    0x3FFF, 0x3FFF, 0x1FFF, 0x1FFD, 0x1E4D,
+};
+
+const uint8_t keyX[70] = {
+    4, 12, 20, 28, 36, 44, 52, 60, 68, 76, 84, 92, 100, 112,
+    6, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 114,
+    7, 18, 26, 34, 42, 50, 58, 66, 74, 82, 90, 98, 111, 255,
+    9, 255, 22, 30, 38, 46, 54, 62, 70, 78, 86, 94, 109, 255,
+    5, 255, 15, 25, 255, 255, 55, 255, 255, 85, 95, 105, 115, 255,
+};
+
+const uint8_t keyY[70] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+    20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 255,
+    28, 255, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 255,
+    36, 255, 36, 36, 255, 255, 36, 255, 255, 36, 36, 36, 36, 255,
+};
+
+const uint8_t keyCenterDistance[70] = {
+    58, 51, 43, 36, 29, 23, 18, 16, 18, 23, 29, 36, 43, 54,
+    55, 45, 37, 29, 22, 14, 9, 9, 14, 22, 29, 37, 45, 55,
+    53, 42, 34, 26, 18, 10, 2, 6, 14, 22, 30, 38, 51, 255,
+    52, 255, 39, 31, 23, 16, 10, 8, 13, 20, 27, 35, 50, 255,
+    57, 255, 48, 38, 255, 255, 17, 255, 255, 30, 38, 48, 57, 255,
+};
+
+const uint8_t keyCenterAngle[70] = {
+    139, 141, 144, 147, 152, 160, 173, 192, 211, 224, 232, 237, 240, 244,
+    134, 135, 137, 139, 144, 152, 173, 211, 232, 240, 245, 247, 249, 250,
+    128, 128, 128, 128, 128, 128, 128, 0, 0, 0, 0, 0, 0, 0,
+    122, 0, 120, 117, 114, 107, 90, 54, 27, 17, 12, 9, 7, 0,
+    116, 0, 114, 111, 0, 0, 76, 0, 0, 23, 17, 14, 12, 0,
+};
+
+const uint8_t keyDistanceTable[2415] = {
+    8, 16, 8, 24, 16, 8, 32, 24, 16, 8, 40, 32, 24, 16, 8, 48,
+    40, 32, 24, 16, 8, 56, 48, 40, 32, 24, 16, 8, 64, 56, 48, 40,
+    32, 24, 16, 8, 72, 64, 56, 48, 40, 32, 24, 16, 8, 80, 72, 64,
+    56, 48, 40, 32, 24, 16, 8, 88, 80, 72, 64, 56, 48, 40, 32, 24,
+    16, 8, 96, 88, 80, 72, 64, 56, 48, 40, 32, 24, 16, 8, 108, 100,
+    92, 84, 76, 68, 60, 52, 44, 36, 28, 20, 12, 8, 10, 16, 23, 31,
+    39, 47, 55, 63, 70, 78, 86, 94, 106, 14, 9, 9, 14, 22, 29, 37,
+    45, 53, 61, 68, 76, 84, 96, 10, 22, 14, 9, 9, 14, 22, 29, 37,
+    45, 53, 61, 68, 76, 88, 18, 8, 29, 22, 14, 9, 9, 14, 22, 29,
+    37, 45, 53, 61, 68, 80, 26, 16, 8, 37, 29, 22, 14, 9, 9, 14,
+    22, 29, 37, 45, 53, 61, 72, 34, 24, 16, 8, 45, 37, 29, 22, 14,
+    9, 9, 14, 22, 29, 37, 45, 53, 64, 42, 32, 24, 16, 8, 53, 45,
+    37, 29, 22, 14, 9, 9, 14, 22, 29, 37, 45, 57, 50, 40, 32, 24,
+    16, 8, 61, 53, 45, 37, 29, 22, 14, 9, 9, 14, 22, 29, 37, 49,
+    58, 48, 40, 32, 24, 16, 8, 68, 61, 53, 45, 37, 29, 22, 14, 9,
+    9, 14, 22, 29, 41, 66, 56, 48, 40, 32, 24, 16, 8, 76, 68, 61,
+    53, 45, 37, 29, 22, 14, 9, 9, 14, 22, 33, 74, 64, 56, 48, 40,
+    32, 24, 16, 8, 84, 76, 68, 61, 53, 45, 37, 29, 22, 14, 9, 9,
+    14, 25, 82, 72, 64, 56, 48, 40, 32, 24, 16, 8, 92, 84, 76, 68,
+    61, 53, 45, 37, 29, 22, 14, 9, 9, 18, 90, 80, 72, 64, 56, 48,
+    40, 32, 24, 16, 8, 100, 92, 84, 76, 68, 61, 53, 45, 37, 29, 22,
+    14, 9, 11, 98, 88, 80, 72, 64, 56, 48, 40, 32, 24, 16, 8, 110,
+    102, 94, 86, 78, 70, 63, 55, 47, 39, 31, 23, 16, 8, 108, 98, 90,
+    82, 74, 66, 58, 50, 42, 34, 26, 18, 10, 16, 17, 21, 26, 33, 40,
+    48, 55, 63, 71, 79, 86, 94, 106, 8, 12, 19, 26, 34, 42, 50, 58,
+    65, 73, 81, 89, 97, 107, 21, 17, 16, 19, 24, 31, 38, 45, 52, 60,
+    68, 76, 84, 95, 14, 8, 10, 16, 23, 31, 39, 47, 55, 63, 70, 78,
+    86, 96, 11, 27, 21, 17, 16, 19, 24, 31, 38, 45, 52, 60, 68, 76,
+    87, 22, 13, 8, 10, 16, 23, 31, 39, 47, 55, 63, 70, 78, 88, 19,
+    8, 34, 27, 21, 17, 16, 19, 24, 31, 38, 45, 52, 60, 68, 80, 29,
+    20, 13, 8, 10, 16, 23, 31, 39, 47, 55, 63, 70, 80, 27, 16, 8,
+    41, 34, 27, 21, 17, 16, 19, 24, 31, 38, 45, 52, 60, 72, 37, 27,
+    20, 13, 8, 10, 16, 23, 31, 39, 47, 55, 63, 72, 35, 24, 16, 8,
+    49, 41, 34, 27, 21, 17, 16, 19, 24, 31, 38, 45, 52, 64, 45, 35,
+    27, 20, 13, 8, 10, 16, 23, 31, 39, 47, 55, 64, 43, 32, 24, 16,
+    8, 56, 49, 41, 34, 27, 21, 17, 16, 19, 24, 31, 38, 45, 56, 53,
+    43, 35, 27, 20, 13, 8, 10, 16, 23, 31, 39, 47, 57, 51, 40, 32,
+    24, 16, 8, 64, 56, 49, 41, 34, 27, 21, 17, 16, 19, 24, 31, 38,
+    49, 61, 51, 43, 35, 27, 20, 13, 8, 10, 16, 23, 31, 39, 49, 59,
+    48, 40, 32, 24, 16, 8, 72, 64, 56, 49, 41, 34, 27, 21, 17, 16,
+    19, 24, 31, 41, 68, 59, 51, 43, 35, 27, 20, 13, 8, 10, 16, 23,
+    31, 41, 67, 56, 48, 40, 32, 24, 16, 8, 80, 72, 64, 56, 49, 41,
+    34, 27, 21, 17, 16, 19, 24, 34, 76, 66, 59, 51, 43, 35, 27, 20,
+    13, 8, 10, 16, 23, 33, 75, 64, 56, 48, 40, 32, 24, 16, 8, 87,
+    80, 72, 64, 56, 49, 41, 34, 27, 21, 17, 16, 19, 27, 84, 74, 66,
+    59, 51, 43, 35, 27, 20, 13, 8, 10, 16, 25, 83, 72, 64, 56, 48,
+    40, 32, 24, 16, 8, 95, 87, 80, 72, 64, 56, 49, 41, 34, 27, 21,
+    17, 16, 21, 92, 82, 74, 66, 59, 51, 43, 35, 27, 20, 13, 8, 10,
+    18, 91, 80, 72, 64, 56, 48, 40, 32, 24, 16, 8, 108, 100, 92, 85,
+    77, 69, 61, 53, 46, 38, 31, 25, 19, 16, 105, 95, 87, 79, 71, 64,
+    56, 48, 40, 32, 24, 17, 11, 9, 104, 93, 85, 77, 69, 61, 53, 45,
+    37, 29, 21, 13, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 25, 24, 26,
+    31, 36, 42, 49, 56, 64, 71, 79, 86, 94, 106, 16, 17, 22, 28, 35,
+    42, 50, 57, 65, 73, 81, 88, 96, 106, 8, 12, 19, 26, 34, 42, 50,
+    58, 65, 73, 81, 89, 102, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 30, 26, 24, 25, 28, 33, 38, 45, 52, 59, 66, 74, 82, 93,
+    23, 17, 16, 19, 24, 31, 38, 45, 52, 60, 68, 76, 84, 93, 17, 9,
+    9, 14, 22, 29, 37, 45, 53, 61, 68, 76, 89, 255, 13, 255, 35, 30,
+    26, 24, 25, 28, 33, 38, 45, 52, 59, 66, 74, 85, 29, 21, 17, 16,
+    19, 24, 31, 38, 45, 52, 60, 68, 76, 86, 24, 14, 9, 9, 14, 22,
+    29, 37, 45, 53, 61, 68, 81, 255, 21, 255, 8, 42, 35, 30, 26, 24,
+    25, 28, 33, 38, 45, 52, 59, 66, 78, 36, 27, 21, 17, 16, 19, 24,
+    31, 38, 45, 52, 60, 68, 78, 32, 22, 14, 9, 9, 14, 22, 29, 37,
+    45, 53, 61, 73, 255, 29, 255, 16, 8, 48, 42, 35, 30, 26, 24, 25,
+    28, 33, 38, 45, 52, 59, 70, 43, 34, 27, 21, 17, 16, 19, 24, 31,
+    38, 45, 52, 60, 70, 40, 29, 22, 14, 9, 9, 14, 22, 29, 37, 45,
+    53, 65, 255, 37, 255, 24, 16, 8, 55, 48, 42, 35, 30, 26, 24, 25,
+    28, 33, 38, 45, 52, 63, 51, 41, 34, 27, 21, 17, 16, 19, 24, 31,
+    38, 45, 52, 62, 48, 37, 29, 22, 14, 9, 9, 14, 22, 29, 37, 45,
+    58, 255, 45, 255, 32, 24, 16, 8, 63, 55, 48, 42, 35, 30, 26, 24,
+    25, 28, 33, 38, 45, 55, 58, 49, 41, 34, 27, 21, 17, 16, 19, 24,
+    31, 38, 45, 54, 56, 45, 37, 29, 22, 14, 9, 9, 14, 22, 29, 37,
+    50, 255, 53, 255, 40, 32, 24, 16, 8, 70, 63, 55, 48, 42, 35, 30,
+    26, 24, 25, 28, 33, 38, 48, 66, 56, 49, 41, 34, 27, 21, 17, 16,
+    19, 24, 31, 38, 47, 64, 53, 45, 37, 29, 22, 14, 9, 9, 14, 22,
+    29, 42, 255, 61, 255, 48, 40, 32, 24, 16, 8, 78, 70, 63, 55, 48,
+    42, 35, 30, 26, 24, 25, 28, 33, 42, 74, 64, 56, 49, 41, 34, 27,
+    21, 17, 16, 19, 24, 31, 39, 71, 61, 53, 45, 37, 29, 22, 14, 9,
+    9, 14, 22, 34, 255, 69, 255, 56, 48, 40, 32, 24, 16, 8, 85, 78,
+    70, 63, 55, 48, 42, 35, 30, 26, 24, 25, 28, 35, 82, 72, 64, 56,
+    49, 41, 34, 27, 21, 17, 16, 19, 24, 32, 79, 68, 61, 53, 45, 37,
+    29, 22, 14, 9, 9, 14, 26, 255, 77, 255, 64, 56, 48, 40, 32, 24,
+    16, 8, 93, 85, 78, 70, 63, 55, 48, 42, 35, 30, 26, 24, 25, 30,
+    89, 80, 72, 64, 56, 49, 41, 34, 27, 21, 17, 16, 19, 26, 87, 76,
+    68, 61, 53, 45, 37, 29, 22, 14, 9, 9, 19, 255, 85, 255, 72, 64,
+    56, 48, 40, 32, 24, 16, 8, 108, 100, 92, 84, 77, 69, 62, 55, 48,
+    41, 35, 29, 26, 24, 104, 94, 86, 79, 71, 63, 55, 48, 40, 33, 26,
+    21, 17, 17, 102, 91, 83, 75, 67, 60, 52, 44, 36, 28, 21, 14, 8,
+    255, 100, 255, 87, 79, 71, 63, 55, 47, 39, 31, 23, 15, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 32, 33, 35, 39, 45, 50, 57, 64, 71, 78, 85, 93,
+    100, 112, 24, 26, 31, 36, 42, 49, 56, 64, 71, 79, 86, 94, 102, 112,
+    16, 21, 26, 33, 40, 48, 55, 63, 71, 79, 86, 94, 107, 255, 9, 255,
+    19, 26, 34, 42, 50, 58, 65, 73, 81, 89, 104, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 34, 32, 32, 35, 38, 43, 49, 55, 62, 69, 76,
+    83, 91, 102, 26, 24, 26, 29, 35, 41, 48, 55, 62, 69, 77, 84, 92,
+    102, 18, 16, 19, 25, 31, 38, 46, 53, 61, 69, 77, 85, 97, 255, 10,
+    255, 11, 17, 24, 32, 40, 48, 56, 64, 71, 79, 94, 255, 10, 255, 38,
+    35, 32, 32, 34, 37, 42, 47, 54, 60, 67, 74, 82, 93, 31, 26, 24,
+    25, 28, 33, 39, 46, 53, 60, 67, 75, 83, 92, 24, 17, 16, 18, 23,
+    30, 37, 44, 52, 59, 67, 75, 87, 255, 18, 255, 9, 9, 15, 22, 30,
+    38, 46, 54, 62, 69, 84, 255, 20, 255, 10, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 60, 54, 47, 42, 37, 34, 32, 32, 35, 38, 43, 49, 55,
+    65, 55, 46, 39, 33, 28, 25, 24, 26, 29, 35, 41, 48, 55, 64, 51,
+    40, 33, 26, 21, 17, 16, 19, 25, 31, 38, 46, 58, 255, 47, 255, 34,
+    26, 19, 12, 8, 11, 17, 24, 32, 40, 55, 255, 50, 255, 40, 30, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    87, 80, 72, 65, 59, 52, 46, 41, 36, 33, 32, 33, 35, 42, 83, 73,
+    66, 58, 51, 44, 38, 32, 27, 25, 24, 26, 31, 38, 80, 69, 61, 53,
+    46, 38, 31, 25, 19, 16, 17, 21, 31, 255, 76, 255, 64, 56, 48, 40,
+    32, 24, 17, 11, 8, 12, 25, 255, 80, 255, 70, 60, 255, 255, 30, 255,
+    255, 96, 89, 82, 74, 67, 60, 54, 47, 42, 37, 34, 32, 32, 36, 92,
+    83, 75, 67, 60, 53, 46, 39, 33, 28, 25, 24, 26, 31, 89, 79, 71,
+    63, 55, 48, 40, 33, 26, 21, 17, 16, 23, 255, 86, 255, 73, 65, 58,
+    50, 42, 34, 26, 19, 12, 8, 16, 255, 90, 255, 80, 70, 255, 255, 40,
+    255, 255, 10, 106, 98, 91, 83, 76, 69, 62, 55, 49, 43, 38, 35, 32,
+    33, 102, 92, 84, 77, 69, 62, 55, 48, 41, 35, 29, 26, 24, 26, 99,
+    88, 81, 73, 65, 57, 50, 42, 35, 28, 22, 17, 17, 255, 96, 255, 83,
+    75, 67, 60, 52, 44, 36, 28, 21, 14, 9, 255, 100, 255, 90, 80, 255,
+    255, 50, 255, 255, 20, 10, 116, 108, 100, 93, 85, 78, 71, 64, 57, 50,
+    45, 39, 35, 32, 112, 102, 94, 86, 79, 71, 64, 56, 49, 42, 36, 31,
+    26, 24, 109, 98, 90, 83, 75, 67, 59, 52, 44, 37, 30, 23, 16, 255,
+    106, 255, 93, 85, 77, 69, 62, 54, 46, 38, 30, 22, 10, 255, 110, 255,
+    100, 90, 255, 255, 60, 255, 255, 30, 20, 10, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+};
+// clang-format on
@@ -0,0 +1,50 @@
+#ifndef GEOMETRY_INCLUDED
+#define GEOMETRY_INCLUDED
+
+#include "board.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Physical layout of the keys, generated by tools/gengeometry.py.
+ *
+ * Positions are in 1/8 of a key (GEO_UNIT per 1u key), measured from the
+ * top-left corner of the board to the key centre. Distances use the same
+ * units. Matrix positions without a key are marked with GEO_INVALID.
+ */
+
+#define GEO_UNIT 8
+#define GEO_INVALID 0xFF
+
+/* Bit per column set when there's a key at that matrix position */
+extern const uint16_t validKeyRows[NUM_ROW];
+
+/* Key centres, indexed like ledColors */
+extern const uint8_t keyX[KEY_COUNT];
+extern const uint8_t keyY[KEY_COUNT];
+
+/* Distance and angle (0..255 is a full turn, 0 points right, growing
+ * clockwise) from the centre of the board */
+extern const uint8_t keyCenterDistance[KEY_COUNT];
+extern const uint8_t keyCenterAngle[KEY_COUNT];
+
+/* Distance between all key pairs, see keyDistance */
+extern const uint8_t keyDistanceTable[KEY_COUNT * (KEY_COUNT - 1) / 2];
+
+static inline bool keyValid(uint8_t row, uint8_t col) {
+  return validKeyRows[row] & (1u << col);
+}
+
+/* Distance between two keys given by their ledColors index. */
+static inline uint8_t keyDistance(uint8_t a, uint8_t b) {
+  if (a == b)
+    return 0;
+  if (a > b) {
+    const uint8_t t = a;
+    a = b;
+    b = t;
+  }
+  return keyDistanceTable[(uint16_t)b * (b - 1) / 2 + a];
+}
+
+#endif
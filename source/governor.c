@@ -0,0 +1,40 @@
+/*
+    ===  governor  ===
+    Adapts the render load to FRAME_BUDGET.
+*/
+#include "governor.h"
+
+uint8_t governorLevel;
+uint16_t frameOverruns;
+
+/* Consecutive cheap frames */
+static uint8_t calmFrames;
+
+bool governorAllowsRender(uint16_t frame) {
+  return (frame & ((1u << governorLevel) - 1)) == 0;
+}
+
+void governorUpdate(uint32_t cost, bool rendered) {
+  if (!rendered)
+    return;
+
+  if (cost > FRAME_BUDGET) {
+    if (frameOverruns < UINT16_MAX)
+      frameOverruns++;
+    if (governorLevel < GOVERNOR_MAX_LEVEL)
+      governorLevel++;
+    calmFrames = 0;
+  } else if (cost < FRAME_BUDGET / 2 && governorLevel > 0) {
+    if (++calmFrames >= GOVERNOR_RECOVERY) {
+      governorLevel--;
+      calmFrames = 0;
+    }
+  } else {
+    calmFrames = 0;
+  }
+}
+
+void governorReset(void) {
+  governorLevel = 0;
+  calmFrames = 0;
+}
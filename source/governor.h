@@ -0,0 +1,48 @@
+#ifndef GOVERNOR_INCLUDED
+#define GOVERNOR_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Render budget governor.
+ *
+ * Profiles render in the PWM interrupt, between two column cycles; a slow
+ * frame leaves the LEDs dark for longer and shows up as flicker, and it
+ * steals time from the protocol thread. The cost of every rendered frame is
+ * checked against FRAME_BUDGET; on an overrun the governor raises the load
+ * level, and lowers it again after a while of cheap frames:
+ *
+ *   level 1+  animations render on every 2^level-th frame only. A profile
+ *             steps at most once per rendered frame, so it keeps its speed
+ *             only while it steps no more often than frames are rendered;
+ *             faster ones slow down
+ *   level 2+  at most one effect layer renders per frame, and the outgoing
+ *             profile of a transition is frozen
+ *
+ * Compositing and the PWM itself keep running on every frame.
+ */
+
+/* Cycles of a rendered frame: a quarter of the 1ms column time at 48MHz */
+#define FRAME_BUDGET 12000
+
+#define GOVERNOR_MAX_LEVEL 3
+/* Level from which work is spread over frames */
+#define GOVERNOR_SPREAD_LEVEL 2
+/* Rendered frames under half of the budget needed to lower the level */
+#define GOVERNOR_RECOVERY 64
+
+extern uint8_t governorLevel;
+/* Frames over the budget since start, saturating */
+extern uint16_t frameOverruns;
+
+/* Should animations be rendered on this frame? */
+bool governorAllowsRender(uint16_t frame);
+
+/* Account a frame; `rendered` is false for frames skipped by the governor */
+void governorUpdate(uint32_t cost, bool rendered);
+
+/* Start over on profile switch */
+void governorReset(void);
+
+#endif
@@ -0,0 +1,114 @@
+/*
+    ===  keyframes  ===
+    Streaming decoder of the palette/RLE animation format.
+*/
+#include "keyframes.h"
+#include "miniFastLED.h"
+#include "string.h"
+
+/* Provided by the linker script */
+extern const uint8_t __anim_base__[];
+extern const uint8_t __anim_end__[];
+
+#define HEADER_SIZE 8
+
+enum {
+  OP_SKIP = 0x00,
+  OP_RUN = 0x40,
+  OP_LITERAL = 0x80,
+};
+
+static inline uint32_t paletteColor(uint8_t idx) {
+  const uint8_t *p = &__anim_base__[HEADER_SIZE + 3 * idx];
+  return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+/* Decode the next frame into player->keys. Returns false on corrupted data. */
+static bool decodeFrame(keyframes_player_t *player) {
+  const uint8_t *p = player->next;
+  uint8_t key = 0;
+
+  if (p >= __anim_end__)
+    return false;
+  player->ticks = *p++;
+  if (player->ticks == 0)
+    player->ticks = 1;
+
+  while (key < KEY_COUNT) {
+    if (p >= __anim_end__)
+      return false;
+    const uint8_t op = *p & 0xC0;
+    const uint8_t count = (*p++ & 0x3F) + 1;
+    if (key + count > KEY_COUNT)
+      return false;
+
+    switch (op) {
+    case OP_SKIP:
+      break;
+    case OP_RUN:
+      if (p >= __anim_end__ || *p >= player->paletteSize)
+        return false;
+      memset(&player->keys[key], *p++, count);
+      break;
+    case OP_LITERAL:
+      if (p + (count + 1) / 2 > __anim_end__)
+        return false;
+      for (uint8_t i = 0; i < count; i++) {
+        const uint8_t idx = (i & 1) ? (p[i / 2] & 0x0F) : (p[i / 2] >> 4);
+        if (idx >= player->paletteSize)
+          return false;
+        player->keys[key + i] = idx;
+      }
+      p += (count + 1) / 2;
+      break;
+    default:
+      return false;
+    }
+    key += count;
+  }
+
+  player->next = p;
+  if (++player->frame == player->frameCount) {
+    player->frame = 0;
+    player->next = player->first;
+  }
+  return true;
+}
+
+bool keyframesRewind(keyframes_player_t *player) {
+  const uint8_t *h = __anim_base__;
+
+  player->valid = false;
+  if (h[0] != 'A' || h[1] != 'P' || h[2] != '2' || h[3] != 'A' ||
+      h[4] != KEYFRAMES_VERSION)
+    return false;
+
+  player->paletteSize = h[5];
+  player->frameCount = h[6] | (h[7] << 8);
+  if (player->paletteSize == 0 || player->paletteSize > KEYFRAMES_MAX_PALETTE ||
+      player->frameCount == 0)
+    return false;
+
+  player->first = h + HEADER_SIZE + 3 * player->paletteSize;
+  player->next = player->first;
+  player->frame = 0;
+  memset(player->keys, 0, sizeof(player->keys));
+
+  player->valid = decodeFrame(player);
+  return player->valid;
+}
+
+void keyframesRender(keyframes_player_t *player, led_t *ledColors) {
+  if (!player->valid) {
+    setAllKeysToBlank(ledColors);
+    return;
+  }
+
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    ledColors[i].rgb = naiveDimRGB(paletteColor(player->keys[i]));
+  }
+
+  /* Corrupted data is noticed one tick late, blank on the next call */
+  if (--player->ticks == 0 && !decodeFrame(player))
+    player->valid = false;
+}
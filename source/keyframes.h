@@ -0,0 +1,51 @@
+#ifndef KEYFRAMES_INCLUDED
+#define KEYFRAMES_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * Playback of pre-designed animations stored in flash behind the firmware
+ * (4kB region at 0xF000, see HT32F52342_AP2.ld). Build the data with
+ * tools/animenc.py.
+ *
+ * Format, all multi-byte values little endian:
+ *
+ *   Header:  'A' 'P' '2' 'A', version (1), palette size (1..16),
+ *            frame count (u16), palette (3 bytes per entry: R G B)
+ *   Frame:   duration in animation ticks (u8, 0 is treated as 1), followed
+ *            by opcodes until all KEY_COUNT keys are covered:
+ *
+ *     00nnnnnn           skip n+1 keys, they keep the previous frame color
+ *     01nnnnnn P         n+1 keys with palette index P
+ *     10nnnnnn P0P1 ...  n+1 literal palette indices, two per byte (high
+ *                        nibble first)
+ *
+ * Frames are decoded one at a time, so RAM use is a single frame of palette
+ * indices plus the read position.
+ */
+
+#define KEYFRAMES_VERSION 1
+#define KEYFRAMES_MAX_PALETTE 16
+
+/* Decoder state; lives in the profile state arena */
+typedef struct {
+  bool valid;
+  uint8_t paletteSize;
+  uint16_t frameCount;
+  /* Position of the first frame and of the next frame to decode */
+  const uint8_t *first;
+  const uint8_t *next;
+  uint16_t frame;
+  /* Ticks left until the next frame */
+  uint8_t ticks;
+  /* Palette index of each key */
+  uint8_t keys[KEY_COUNT];
+} keyframes_player_t;
+
+/* Rewind to the first frame. Returns false if there's no valid data. */
+bool keyframesRewind(keyframes_player_t *player);
+
+/* Advance by one tick and paint current frame */
+void keyframesRender(keyframes_player_t *player, led_t *ledColors);
+
+#endif
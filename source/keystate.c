@@ -0,0 +1,19 @@
+/*
+    ===  keystate  ===
+    Pressed keys and their press times.
+*/
+#include "keystate.h"
+
+bitboard_t pressedKeys;
+uint16_t pressTime[KEY_COUNT];
+
+void keyDown(uint8_t row, uint8_t col) {
+  if (!bitboardTest(&pressedKeys, row, col)) {
+    pressTime[ROWCOL2IDX(row, col)] = frameCounter;
+  }
+  bitboardSet(&pressedKeys, row, col);
+}
+
+void keyUp(uint8_t row, uint8_t col) { bitboardClear(&pressedKeys, row, col); }
+
+void keysReleaseAll(void) { bitboardClearAll(&pressedKeys); }
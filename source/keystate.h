@@ -0,0 +1,32 @@
+#ifndef KEYSTATE_INCLUDED
+#define KEYSTATE_INCLUDED
+
+#include "bitboard.h"
+#include "matrix.h"
+
+/*
+ * Keys currently held down, updated from CMD_LED_KEY_DOWN/UP.
+ *
+ * The main MCU only reports keys while the profile is reactive, so the state
+ * is forgotten on profile switch rather than risking keys stuck down.
+ */
+
+extern bitboard_t pressedKeys;
+
+/* frameCounter value at the time each key was pressed */
+extern uint16_t pressTime[KEY_COUNT];
+
+void keyDown(uint8_t row, uint8_t col);
+void keyUp(uint8_t row, uint8_t col);
+void keysReleaseAll(void);
+
+static inline bool keyPressed(uint8_t row, uint8_t col) {
+  return bitboardTest(&pressedKeys, row, col);
+}
+
+/* Frames a pressed key has been held for */
+static inline uint16_t keyHeldFrames(uint8_t ledIndex) {
+  return frameCounter - pressTime[ledIndex];
+}
+
+#endif
@@ -0,0 +1,173 @@
+/*
+    ===  layers  ===
+    Effect layer stack and the blending kernels used to composite it.
+*/
+#include "layers.h"
+#include "blend.h"
+#include "governor.h"
+#include "string.h"
+
+layer_t layers[LAYER_COUNT];
+led_t ledComposite[KEY_COUNT];
+
+/* Blend a pixel of a layer over the pixel below it */
+static inline uint32_t blendPixel(const layer_t *layer, uint16_t alpha,
+                                  uint32_t dst, uint32_t src) {
+  uint32_t out;
+  src &= RGB_MASK;
+  switch (layer->blend) {
+  case BLEND_ADD:
+    out = blendAdd(dst, src);
+    break;
+  case BLEND_MULTIPLY:
+    out = blendMultiply(dst, src);
+    break;
+  case BLEND_SCREEN:
+    out = blendScreen(dst, src);
+    break;
+  case BLEND_MAX:
+    out = blendMax(dst, src);
+    break;
+  default:
+    out = src;
+    break;
+  }
+  if (alpha != 256)
+    out = blendOpacity(dst, out, alpha);
+  return out;
+}
+
+/* Blend one layer over ledComposite */
+static void compositeLayer(const layer_t *layer) {
+  const uint16_t alpha = blendAlpha(layer->opacity);
+
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    ledComposite[i].rgb =
+        blendPixel(layer, alpha, ledComposite[i].rgb, layer->colors[i].rgb);
+  }
+}
+
+/* Run the layer profile callback with its own state */
+static inline void renderLayer(layer_t *layer) {
+  profile_state *const base = profileState;
+  profileState = &layer->state;
+  profiles[layer->profile].callback(layer->colors);
+  profileState = base;
+}
+
+/* Same for the profile init of a layer just set */
+static inline void initLayer(layer_t *layer) {
+  const profile_init pinit = profiles[layer->profile].profileInit;
+  layer->needsInit = false;
+  if (pinit == NULL)
+    return;
+  profile_state *const base = profileState;
+  profileState = &layer->state;
+  pinit(layer->colors);
+  profileState = base;
+}
+
+bool layerSet(uint8_t layer, uint8_t profile, uint8_t speed, uint8_t opacity,
+              uint8_t blend) {
+  if (layer >= LAYER_COUNT || profile >= amountOfProfiles ||
+      blend >= BLEND_MODE_COUNT)
+    return false;
+
+  layer_t *l = &layers[layer];
+
+  /* Rendering and compositing happen in the PWM interrupt, which also
+   * initializes the profile on the next frame */
+  chSysLock();
+  memset(l, 0, sizeof(*l));
+  l->profile = profile;
+  l->rate = profileAnimationRate(&profiles[profile], speed);
+  l->opacity = opacity;
+  l->blend = blend;
+  l->needsInit = true;
+  l->needsRender = true;
+  l->enabled = true;
+  chSysUnlock();
+  return true;
+}
+
+void layerClear(uint8_t layer) {
+  if (layer < LAYER_COUNT)
+    layers[layer].enabled = false;
+}
+
+bool layersReactive(void) {
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    if (layers[i].enabled && profiles[layers[i].profile].keypressCallback)
+      return true;
+  }
+  return false;
+}
+
+void layersKeypress(uint8_t row, uint8_t col) {
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    layer_t *l = &layers[i];
+    const keypress_handler handler = profiles[l->profile].keypressCallback;
+    if (!l->enabled || l->needsInit || handler == NULL)
+      continue;
+    profile_state *const base = profileState;
+    profileState = &l->state;
+    handler(l->colors, row, col);
+    profileState = base;
+    /* Render on the next frame */
+    l->needsRender = true;
+  }
+}
+
+const led_t *layersRender(const led_t *base, uint8_t frames) {
+  bool active = false;
+  /* Under load, render one layer per frame; the others wait their turn */
+  const bool spread = governorLevel >= GOVERNOR_SPREAD_LEVEL;
+  bool rendered = false;
+
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    layer_t *l = &layers[i];
+    if (!l->enabled)
+      continue;
+    active = true;
+    if (l->needsInit)
+      initLayer(l);
+    if (frames == 0)
+      continue;
+
+    bool due = l->needsRender;
+    if (animationAdvance(&l->phase, l->rate, frames))
+      due = true;
+    if (due && spread && rendered) {
+      l->needsRender = true;
+    } else if (due) {
+      l->needsRender = false;
+      renderLayer(l);
+      rendered = true;
+    }
+  }
+
+  if (!active)
+    return base;
+
+  /* The base may already be composited in place */
+  if (base != ledComposite) {
+    for (uint8_t i = 0; i < KEY_COUNT; i++) {
+      ledComposite[i].rgb = base[i].rgb & RGB_MASK;
+    }
+  }
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    if (layers[i].enabled)
+      compositeLayer(&layers[i]);
+  }
+  return ledComposite;
+}
+
+uint32_t layersCompositeKey(uint8_t key, uint32_t base) {
+  uint32_t out = base & RGB_MASK;
+  for (uint8_t i = 0; i < LAYER_COUNT; i++) {
+    const layer_t *l = &layers[i];
+    if (l->enabled)
+      out = blendPixel(l, blendAlpha(l->opacity), out, l->colors[key].rgb);
+  }
+  return out;
+}
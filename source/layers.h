@@ -0,0 +1,73 @@
+#ifndef LAYERS_INCLUDED
+#define LAYERS_INCLUDED
+
+#include "profiles.h"
+
+/*
+ * Effect layers stacked on top of the current profile.
+ *
+ * Each layer runs its own instance of a profile (with its own state and
+ * frame buffer) at its own speed. On every frame the layers are blended over
+ * the base frame in order into ledComposite, which is then displayed instead.
+ * With no layers enabled, the base frame is displayed directly and layers
+ * cost nothing but their RAM: a frame and a profile state each (~440 bytes).
+ */
+
+/* A base effect with one reactive effect or scrolling text over it, or both */
+#ifndef LAYER_COUNT
+#define LAYER_COUNT 2
+#endif
+
+typedef enum {
+  BLEND_REPLACE = 0,
+  BLEND_ADD,
+  BLEND_MULTIPLY,
+  BLEND_SCREEN,
+  BLEND_MAX,
+  BLEND_MODE_COUNT
+} blend_mode;
+
+typedef struct {
+  /* Animation phase step and accumulator, see animationRate */
+  uint32_t rate;
+  uint32_t phase;
+  bool enabled;
+  uint8_t profile;
+  /* 0 - transparent, 255 - fully opaque */
+  uint8_t opacity;
+  uint8_t blend;
+  /* Static profiles are rendered once */
+  bool needsRender;
+  /* Set, the profile init runs on the next frame */
+  bool needsInit;
+  profile_state state;
+  led_t colors[KEY_COUNT];
+} layer_t;
+
+extern layer_t layers[LAYER_COUNT];
+
+/* Frame displayed when layers are enabled */
+extern led_t ledComposite[KEY_COUNT];
+
+/* Enable a layer. Returns false on invalid arguments. */
+bool layerSet(uint8_t layer, uint8_t profile, uint8_t speed, uint8_t opacity,
+              uint8_t blend);
+
+/* Disable a layer */
+void layerClear(uint8_t layer);
+
+/* Is any layer running a reactive profile? */
+bool layersReactive(void);
+
+/* Pass a keypress to reactive layers */
+void layersKeypress(uint8_t row, uint8_t col);
+
+/* Called by the PWM interrupt on frame boundary: advance layer animations
+ * by `frames` (0 - paused) and composite them over `base`, which can be
+ * ledComposite itself. Returns the buffer to display. */
+const led_t *layersRender(const led_t *base, uint8_t frames);
+
+/* Composite a single key over its `base` color, as layersRender would */
+uint32_t layersCompositeKey(uint8_t key, uint32_t base);
+
+#endif
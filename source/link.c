@@ -0,0 +1,140 @@
+/*
+    ===  link  ===
+    Baud rate and feature negotiation with the main MCU.
+*/
+#include "link.h"
+#include "ch.h"
+#include "hal.h"
+
+static const uint32_t baudRates[LINK_BAUD_COUNT] = LINK_BAUD_RATES;
+
+/* Modified in place on rate switch */
+static SerialConfig linkConfig = {.speed = 115200};
+
+static event_listener_t linkListener;
+
+uint8_t linkBaud;
+uint8_t linkFeatures;
+sysinterval_t linkIdle;
+uint16_t linkOverruns;
+
+static struct {
+  /* Waiting for the handshake at the new rate */
+  bool probation;
+  /* Start of the probation or of the error window */
+  systime_t since;
+  uint16_t errors;
+  /* proto.errors seen by the last poll */
+  uint8_t protoErrors;
+} health;
+
+static void restartWindow(void) {
+  health.since = chVTGetSystemTimeX();
+  health.errors = 0;
+  health.protoErrors = proto.errors;
+}
+
+static void updateIdle(void) {
+  const uint32_t us = LINK_IDLE_BYTES * 10 * 1000000u / baudRates[linkBaud];
+  linkIdle = TIME_US2I(us);
+  if (linkIdle < TIME_MS2I(1))
+    linkIdle = TIME_MS2I(1);
+}
+
+/* Restart the driver at a new rate once the queued replies are sent */
+static void setBaud(uint8_t baud) {
+  bool drained;
+  do {
+    /* Also gives the USART FIFO time to empty after the queue */
+    chThdSleepMilliseconds(1);
+    chSysLock();
+    drained = oqIsEmptyI(&PROTOCOL_SD.oqueue);
+    chSysUnlock();
+  } while (!drained);
+  chThdSleepMilliseconds(1);
+
+  sdStop(&PROTOCOL_SD);
+  linkConfig.speed = baudRates[baud];
+  sdStart(&PROTOCOL_SD, &linkConfig);
+  linkBaud = baud;
+  updateIdle();
+
+  /* Drop a frame cut by the switch */
+  proto.state = STATE_SYNC_1;
+  restartWindow();
+}
+
+static void fallback(void) {
+  linkFeatures = 0;
+  protoSetFeatures(&proto, 0);
+  health.probation = false;
+  setBaud(0);
+}
+
+void linkInit(void) {
+  sdStart(&PROTOCOL_SD, &linkConfig);
+  updateIdle();
+  chEvtRegisterMaskWithFlags(chnGetEventSource(&PROTOCOL_SD), &linkListener,
+                             LINK_EVENT,
+                             CHN_INPUT_AVAILABLE | CHN_OUTPUT_EMPTY |
+                                 SD_FRAMING_ERROR | SD_NOISE_ERROR |
+                                 SD_OVERRUN_ERROR | SD_QUEUE_FULL_ERROR);
+}
+
+void linkHello(const message_t *msg) {
+  if (msg->payloadSize < 2) {
+    proto.errors++;
+    return;
+  }
+
+  /* Highest common rate */
+  const uint8_t common = msg->payload[0] & LINK_BAUD_MASK;
+  uint8_t baud = 0;
+  for (uint8_t i = 1; i < LINK_BAUD_COUNT; i++) {
+    if (common & (1u << i))
+      baud = i;
+  }
+  linkFeatures = msg->payload[1] & LINK_FEATURES;
+
+  /* Reply at the current rate */
+  const uint8_t payload[] = {LINK_BAUD_MASK, LINK_FEATURES, baud,
+                             linkFeatures};
+  protoTx(CMD_LED_LINK_CAPS, payload, sizeof(payload), 1);
+  protoSetFeatures(&proto, linkFeatures);
+
+  if (baud != linkBaud) {
+    setBaud(baud);
+    health.probation = baud != 0;
+  } else {
+    /* Repeated over the new rate - it works both ways */
+    health.probation = false;
+    restartWindow();
+  }
+}
+
+void linkPoll(void) {
+  const eventflags_t flags = chEvtGetAndClearFlags(&linkListener);
+  const uint8_t protoErrors = proto.errors;
+  const uint8_t newErrors = protoErrors - health.protoErrors;
+  health.protoErrors = protoErrors;
+
+  if ((flags & (SD_OVERRUN_ERROR | SD_QUEUE_FULL_ERROR)) &&
+      linkOverruns < UINT16_MAX)
+    linkOverruns++;
+
+  /* Nothing to fall back from */
+  if (linkBaud == 0 && linkFeatures == 0)
+    return;
+
+  if (flags & (SD_FRAMING_ERROR | SD_NOISE_ERROR))
+    health.errors++;
+  health.errors += newErrors;
+
+  const sysinterval_t elapsed = chVTTimeElapsedSinceX(health.since);
+  if (health.errors >= LINK_ERROR_LIMIT ||
+      (health.probation && elapsed >= TIME_MS2I(LINK_PROBATION_MS))) {
+    fallback();
+  } else if (!health.probation && elapsed >= TIME_MS2I(1000)) {
+    restartWindow();
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef LINK_INCLUDED
+#define LINK_INCLUDED
+
+#include "ch.h"
+#include "protocol.h"
+#include <stdbool.h>
+
+/*
+ * UART link to the main MCU.
+ *
+ * The link starts at 115200 baud. CMD_LED_LINK_HELLO advertises the baud
+ * rates and protocol features the main MCU supports; the LED picks the
+ * highest common rate, replies with CMD_LED_LINK_CAPS and switches. The new
+ * rate stays on probation until the main MCU repeats the handshake over it.
+ *
+ * The link falls back to 115200, with no features, if that doesn't happen
+ * within LINK_PROBATION_MS or after LINK_ERROR_LIMIT framing or protocol
+ * errors within a second - eg. when the main MCU was reset and talks at
+ * 115200 again.
+ *
+ * Received bytes are queued by the USART interrupt; the protocol thread sleeps
+ * on LINK_EVENT until a burst arrives and then drains the queue at once.
+ */
+
+/* Rates supported on our side, see LINK_BAUD_RATES. The USART divides its
+ * 48MHz clock by 16 at least, so all of them. */
+#define LINK_BAUD_MASK 0x7F
+
+/* Protocol features supported on our side */
+#define LINK_FEATURES (PROTO_FEATURE_CRC | PROTO_FEATURE_BATCH)
+
+#define LINK_PROBATION_MS 250
+#define LINK_ERROR_LIMIT 8
+
+/* Input available, output sent or an USART error, see linkInit. Also
+ * signalled when a reply is queued. */
+#define LINK_EVENT EVENT_MASK(0)
+
+/* Silence within a frame, in byte times, after which the frame is dropped. At
+ * least 1ms, the main MCU may be preempted between the header and payload. */
+#define LINK_IDLE_BYTES 16
+
+/* Index of the current rate in LINK_BAUD_RATES */
+extern uint8_t linkBaud;
+/* Features both sides support */
+extern uint8_t linkFeatures;
+/* LINK_IDLE_BYTES at the current rate */
+extern sysinterval_t linkIdle;
+/* Receive overruns of the USART or the queue, saturating */
+extern uint16_t linkOverruns;
+
+/* Start the serial driver at the base rate and subscribe the calling thread
+ * to LINK_EVENT */
+void linkInit(void);
+
+/* Handle CMD_LED_LINK_HELLO */
+void linkHello(const message_t *msg);
+
+/* Account USART errors and fall back if needed. Call from the protocol thread
+ * after every wakeup. */
+void linkPoll(void);
+
+#endif
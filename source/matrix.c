@@ -1,9 +1,16 @@
 /* Algorithm controlling the LEDs. */
 
 #include "matrix.h"
+#include "bitboard.h"
 #include "board.h"
+#include "commands.h"
+#include "frameUpload.h"
+#include "governor.h"
 #include "hal.h"
+#include "layers.h"
+#include "perf.h"
 #include "settings.h"
+#include "transition.h"
 
 /* LED Matrix state */
 led_t ledColors[KEY_COUNT];
@@ -16,14 +23,41 @@ bool needToCallbackProfile = false;
 bool matrixEnabled;
 
 /* Animations */
-/* If non-zero the animation is enabled; 1 is full speed */
-volatile uint16_t animationSkipTicks = 0;
+volatile uint32_t animationRate = 0;
 
-/* Animation tick counter used to slow down animations */
-uint16_t animationTicks = 0;
+/* Animation phase accumulator; fractional rates pace the steps evenly */
+uint32_t animationPhase = 0;
+
+/* Frames since animations last advanced, including the ones skipped by the
+ * governor, so skipping frames doesn't slow animations down */
+static uint8_t pendingFrames;
+
+/* Displayed frame: ledColors, or ledComposite during a transition or when
+ * layers are enabled */
+static const led_t *ledOutput = ledColors;
+
+/* Render cost of the last and the most expensive frame in CPU cycles */
+uint32_t frameCost;
+uint32_t frameCostMax;
+
+/* Frames rendered since start, wraps around */
+uint16_t frameCounter;
+
+/* Keypresses whose handlers didn't run yet, see matrixKeyPressI */
+static bitboard_t pendingPresses;
+
+/* Keypress to light latency, see matrixKeyPressI */
+uint32_t keyLatency;
+uint32_t keyLatencyMax;
+/* Columns with a measured press not lit yet, and when the first one of each
+ * was pressed */
+static uint16_t latencyColumns;
+static uint32_t latencyStart[NUM_COLUMN];
 
 /* Internal function prototypes */
+static void keypressesApply(void);
 static void animationCallback(void);
+static void renderFrame(void);
 static void mainCallback(GPTDriver *_driver);
 static void pwmRowDimmer(void);
 static void pwmNextColumn(void);
@@ -127,7 +161,7 @@ static inline void pwmNextColumn() {
     } else if (ledMask[ledIndex].p.alpha && !backlightDisabled) {
       cl = ledMask[ledIndex];
     } else if (!backlightDisabled) {
-      cl = ledColors[ledIndex];
+      cl = ledOutput[ledIndex];
     } else {
       // user disabled backlight, but sticky keys are keeping
       // it alive, unless a sticky key exists, led should
@@ -173,6 +207,41 @@ static inline void pwmNextColumn() {
   if (rowsEnabled) {
     palSetLine(ledColumns[currentColumn]);
   }
+
+  if (latencyColumns & (1u << currentColumn)) {
+    latencyColumns &= ~(1u << currentColumn);
+    keyLatency = perfNow() - latencyStart[currentColumn];
+    if (keyLatency > keyLatencyMax) {
+      keyLatencyMax = keyLatency;
+    }
+  }
+}
+
+/*
+ * Run the handlers of the keys pressed since the last column boundary, while
+ * all rows are off
+ */
+static inline void keypressesApply() {
+  const keypress_handler handler = profiles[currentProfile].keypressCallback;
+
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint16_t bits = pendingPresses.rows[row]; bits; bits &= bits - 1) {
+      const uint8_t col = bitboardLowest(bits);
+      const uint8_t ledIndex = ROWCOL2IDX(row, col);
+      if (handler != NULL) {
+        handler(ledColors, row, col);
+      }
+      layersKeypress(row, col);
+
+      /* A composited frame gets just this key blended again, with the
+       * transition and layers over it. Animations keep their pace. */
+      if (ledOutput == ledComposite) {
+        ledComposite[ledIndex].rgb =
+            layersCompositeKey(ledIndex, transitionKey(ledIndex));
+      }
+    }
+    pendingPresses.rows[row] = 0;
+  }
 }
 
 /*
@@ -182,6 +251,37 @@ static inline void animationCallback() {
   profiles[currentProfile].callback(ledColors);
 }
 
+/*
+ * Advance animations and composite layers once per full column cycle
+ */
+static inline void renderFrame() {
+  const uint32_t start = perfNow();
+
+  frameUploadApply();
+  frameCounter++;
+  if (!manualControl && pendingFrames < UINT8_MAX)
+    pendingFrames++;
+  const bool animate = !manualControl && governorAllowsRender(frameCounter);
+  const uint8_t frames = animate ? pendingFrames : 0;
+  if (animate)
+    pendingFrames = 0;
+
+  if (animationAdvance(&animationPhase, animationRate, frames)) {
+    animationCallback();
+  }
+
+  /* In manual mode, or when the governor skips this frame, transitions and
+   * layers are still composited over ledColors, but they don't animate */
+  const led_t *base = transitionRender(frames);
+  ledOutput = layersRender(base, frames);
+
+  frameCost = perfNow() - start;
+  if (frameCost > frameCostMax) {
+    frameCostMax = frameCost;
+  }
+  governorUpdate(frameCost, animate);
+}
+
 /*
  * mainCallback is called by GPT timer periodically
  * and is responsible for 2 things:
@@ -203,16 +303,19 @@ void mainCallback(GPTDriver *_driver) {
     profiles[currentProfile].callback(ledColors);
   }
 
+  keypressesApply();
+
   /* Animation can be updated after each full column cycle. On
    * pwmCounterLimit=80 + 80kHz timer this refreshes at 80kHz/80/14 = 71Hz and
    * should be a sensible maximum speed for a fluent smooth animation.
    */
-  if (!manualControl && animationSkipTicks > 0 && currentColumn == 13) {
-    animationTicks++;
-    if (animationTicks >= animationSkipTicks) {
-      animationTicks = 0;
-      animationCallback();
-    }
+  if (currentColumn == 13) {
+    renderFrame();
+
+    /* Apply the queued commands before the next frame */
+    chSysLockFromISR();
+    commandsFrameI();
+    chSysUnlockFromISR();
   }
 
   /* We start a new PWM column cycle. */
@@ -221,6 +324,24 @@ void mainCallback(GPTDriver *_driver) {
   pwmNextColumn();
 }
 
+/*
+ * Make a keypress visible as soon as possible: its handlers run at the next
+ * column boundary and it shows on the next scan of its column. Called with
+ * the system locked.
+ *
+ * Every press is measured, except that keys of one column light up together:
+ * the first press of a column stands for the ones after it until the column
+ * is lit, and it waits the longest.
+ */
+void matrixKeyPressI(uint8_t row, uint8_t col) {
+  bitboardSet(&pendingPresses, row, col);
+
+  if (!(latencyColumns & (1u << col))) {
+    latencyColumns |= 1u << col;
+    latencyStart[col] = perfNow();
+  }
+}
+
 /*
  * Turn off LEDs and PWM interrupt.
  */
@@ -22,14 +22,42 @@ extern led_t ledSticky[KEY_COUNT];
 extern bool needToCallbackProfile;
 
 /* Animations */
-/* If non-zero the animation is enabled; 1 is full speed */
-extern volatile uint16_t animationSkipTicks;
+/* Animation phase of one profile step (0.16 fixed point) */
+#define ANIMATION_PHASE_ONE 0x10000u
+
+/* Phase advanced on every frame, 0 for static profiles. The profile steps
+ * each time the phase wraps, ANIMATION_PHASE_ONE is full speed. */
+extern volatile uint32_t animationRate;
+
+/* Frames rendered since start, wraps around */
+extern uint16_t frameCounter;
+
+/* Render cost of the last and the most expensive frame in CPU cycles */
+extern uint32_t frameCost;
+extern uint32_t frameCostMax;
+
+/* Time from a keypress being handled to its column being lit, in CPU
+ * cycles: last and worst */
+extern uint32_t keyLatency;
+extern uint32_t keyLatencyMax;
 
 /* Is matrix enabled? */
 extern bool matrixEnabled;
 
-/* Animation tick counter used to slow down animations */
-extern uint16_t animationTicks;
+/* Animation phase accumulator */
+extern uint32_t animationPhase;
+
+/* Advance a phase accumulator by `frames` frames (0 - paused). Returns true
+ * when the animation is due a step; more than one step per rendered frame
+ * is dropped. */
+static inline bool animationAdvance(uint32_t *phase, uint32_t rate,
+                                    uint8_t frames) {
+  *phase += rate * frames;
+  if (*phase < ANIMATION_PHASE_ONE)
+    return false;
+  *phase &= ANIMATION_PHASE_ONE - 1;
+  return true;
+}
 
 /* Forced colors by main chip */
 // Flag to check if there is a foreground color currently active
@@ -39,5 +67,6 @@ extern uint32_t foregroundColor;
 void matrixInit(void);
 void matrixEnable(void);
 void matrixDisable(void);
+void matrixKeyPressI(uint8_t row, uint8_t col);
 
 #endif
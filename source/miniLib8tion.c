@@ -0,0 +1,113 @@
+/*
+    ===  miniLib8tion  ===
+    This file contains fixed point math adapted from the FastLED project
+   (MIT License)
+*/
+#include "miniLib8tion.h"
+
+// Quarter of a sine wave: round(127 * sin(i * PI / 128)) for i = 0..64
+static const uint8_t sinQuarter[65] = {
+    0,   3,   6,   9,   12,  16,  19,  22,  25,  28,  31,  34,  37,
+    40,  43,  46,  49,  51,  54,  57,  60,  63,  65,  68,  71,  73,
+    76,  78,  81,  83,  85,  88,  90,  92,  94,  96,  98,  100, 102,
+    104, 106, 107, 109, 111, 112, 113, 115, 116, 117, 118, 120, 121,
+    122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127, 127};
+
+// Ken Perlin's permutation table, used to hash the noise lattice
+static const uint8_t perm[256] = {
+    151, 160, 137, 91,  90,  15,  131, 13,  201, 95,  96,  53,  194, 233, 7,
+    225, 140, 36,  103, 30,  69,  142, 8,   99,  37,  240, 21,  10,  23,  190,
+    6,   148, 247, 120, 234, 75,  0,   26,  197, 62,  94,  252, 219, 203, 117,
+    35,  11,  32,  57,  177, 33,  88,  237, 149, 56,  87,  174, 20,  125, 136,
+    171, 168, 68,  175, 74,  165, 71,  134, 139, 48,  27,  166, 77,  146, 158,
+    231, 83,  111, 229, 122, 60,  211, 133, 230, 220, 105, 92,  41,  55,  46,
+    245, 40,  244, 102, 143, 54,  65,  25,  63,  161, 1,   216, 80,  73,  209,
+    76,  132, 187, 208, 89,  18,  169, 200, 196, 135, 130, 116, 188, 159, 86,
+    164, 100, 109, 198, 173, 186, 3,   64,  52,  217, 226, 250, 124, 123, 5,
+    202, 38,  147, 118, 126, 255, 82,  85,  212, 207, 206, 59,  227, 47,  16,
+    58,  17,  182, 189, 28,  42,  223, 183, 170, 213, 119, 248, 152, 2,   44,
+    154, 163, 70,  221, 153, 101, 155, 167, 43,  172, 9,   129, 22,  39,  253,
+    19,  98,  108, 110, 79,  113, 224, 232, 178, 185, 112, 104, 218, 246, 97,
+    228, 251, 34,  242, 193, 238, 210, 144, 12,  191, 179, 162, 241, 81,  51,
+    145, 235, 249, 14,  239, 107, 49,  192, 214, 31,  181, 199, 106, 157, 184,
+    84,  204, 176, 115, 121, 50,  45,  127, 4,   150, 254, 138, 236, 205, 93,
+    222, 114, 67,  29,  24,  72,  243, 141, 128, 195, 78,  66,  215, 61,  156,
+    180};
+
+// xorshift32 state; must never be zero
+static uint32_t rngState = 0x1D7A2021;
+
+// Sine approximation: 0..255 angle in, 1..255 value out (128 is zero)
+uint8_t sin8(uint8_t theta) {
+  const uint8_t offset = theta & 0x3F;
+  uint8_t v;
+  if (theta & 0x40) {
+    v = sinQuarter[64 - offset];
+  } else {
+    v = sinQuarter[offset];
+  }
+  if (theta & 0x80)
+    return 128 - v;
+  return 128 + v;
+}
+
+/*
+    Value noise
+*/
+
+/* Smooth the position within a lattice cell to hide the grid */
+static inline uint8_t fade8(uint8_t t) { return ease8InOutQuad(t); }
+
+uint8_t noise8_2d(uint16_t x, uint16_t y) {
+  const uint8_t xi = x >> 8, yi = y >> 8;
+  const uint8_t u = fade8(x & 0xFF), v = fade8(y & 0xFF);
+
+  const uint8_t a = perm[xi] + yi;
+  const uint8_t b = perm[(uint8_t)(xi + 1)] + yi;
+
+  const uint8_t x1 = lerp8by8(perm[a], perm[b], u);
+  const uint8_t x2 =
+      lerp8by8(perm[(uint8_t)(a + 1)], perm[(uint8_t)(b + 1)], u);
+  return lerp8by8(x1, x2, v);
+}
+
+uint8_t noise8_3d(uint16_t x, uint16_t y, uint16_t z) {
+  const uint8_t xi = x >> 8, yi = y >> 8, zi = z >> 8;
+  const uint8_t u = fade8(x & 0xFF), v = fade8(y & 0xFF), w = fade8(z & 0xFF);
+
+  const uint8_t a = perm[xi] + yi;
+  const uint8_t aa = perm[a] + zi;
+  const uint8_t ab = perm[(uint8_t)(a + 1)] + zi;
+  const uint8_t b = perm[(uint8_t)(xi + 1)] + yi;
+  const uint8_t ba = perm[b] + zi;
+  const uint8_t bb = perm[(uint8_t)(b + 1)] + zi;
+
+  /* Front (z) face, then the back one */
+  const uint8_t f1 = lerp8by8(perm[aa], perm[ba], u);
+  const uint8_t f2 = lerp8by8(perm[ab], perm[bb], u);
+  const uint8_t b1 =
+      lerp8by8(perm[(uint8_t)(aa + 1)], perm[(uint8_t)(ba + 1)], u);
+  const uint8_t b2 =
+      lerp8by8(perm[(uint8_t)(ab + 1)], perm[(uint8_t)(bb + 1)], u);
+
+  return lerp8by8(lerp8by8(f1, f2, v), lerp8by8(b1, b2, v), w);
+}
+
+/*
+    PRNG
+*/
+
+void randomSetSeed(uint32_t seed) {
+  if (seed == 0)
+    seed = 0x1D7A2021;
+  rngState = seed;
+}
+
+uint32_t random32(void) {
+  uint32_t x = rngState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  rngState = x;
+  return x;
+}
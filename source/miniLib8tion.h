@@ -0,0 +1,129 @@
+/*
+    License & Copyright notice:
+    The code included in this file and miniLib8tion.c have been adapted from
+   the lib8tion part of the FastLED project which is licensed under the MIT
+   License.
+    https://github.com/FastLED/FastLED/blob/master/LICENSE
+*/
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 FastLED
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef MINILIB8TION_INCLUDED
+#define MINILIB8TION_INCLUDED
+
+#include <stdint.h>
+
+/*
+    Fixed point math for lighting effects. The LED MCU has no FPU, so every
+    curve here works on 8-bit angles/fractions: 0..255 maps to one full turn
+    (for sin8/cos8) or to 0.0..1.0 (for scaling and easing).
+*/
+
+/* Scale i by scale/256, with 255 meaning "almost" 1.0 and 0 meaning 0 */
+static inline uint8_t scale8(uint8_t i, uint8_t scale) {
+  return ((uint16_t)i * (1 + (uint16_t)scale)) >> 8;
+}
+
+/* Saturating add/sub - clamp at 255 and 0 respectively */
+static inline uint8_t qadd8(uint8_t i, uint8_t j) {
+  const uint16_t t = i + j;
+  return t > 255 ? 255 : t;
+}
+
+static inline uint8_t qsub8(uint8_t i, uint8_t j) {
+  return i > j ? i - j : 0;
+}
+
+/* Linear interpolation between a and b; frac 0 gives a, 255 almost b */
+static inline uint8_t lerp8by8(uint8_t a, uint8_t b, uint8_t frac) {
+  if (b > a)
+    return a + scale8(b - a, frac);
+  return a - scale8(a - b, frac);
+}
+
+/*
+    Waves and easing
+*/
+uint8_t sin8(uint8_t theta);
+
+static inline uint8_t cos8(uint8_t theta) { return sin8(theta + 64); }
+
+/* Triangle wave: 0 -> 254 -> 0 over one 0..255 period */
+static inline uint8_t triwave8(uint8_t in) {
+  if (in & 0x80)
+    in = 255 - in;
+  return in << 1;
+}
+
+/* Ease in/out with a quadratic curve: slow at both ends */
+static inline uint8_t ease8InOutQuad(uint8_t i) {
+  uint8_t j = i;
+  if (j & 0x80)
+    j = 255 - j;
+  uint8_t jj2 = scale8(j, j) << 1;
+  if (i & 0x80)
+    jj2 = 255 - jj2;
+  return jj2;
+}
+
+/* Ease in/out with a cubic curve: 3x^2 - 2x^3 */
+static inline uint8_t ease8InOutCubic(uint8_t i) {
+  const uint8_t ii = scale8(i, i);
+  const uint8_t iii = scale8(ii, i);
+  const uint16_t r = 3 * (uint16_t)ii - 2 * (uint16_t)iii;
+  return (r & 0x100) ? 255 : r;
+}
+
+/* Triangle wave with quadratic/cubic easing - closer to sine, but cheaper */
+static inline uint8_t quadwave8(uint8_t in) {
+  return ease8InOutQuad(triwave8(in));
+}
+
+static inline uint8_t cubicwave8(uint8_t in) {
+  return ease8InOutCubic(triwave8(in));
+}
+
+/*
+    Value noise. Coordinates are 8.8 fixed point: the upper byte selects the
+    lattice cell, the lower byte is the position within it. Returns 0..255.
+*/
+uint8_t noise8_2d(uint16_t x, uint16_t y);
+uint8_t noise8_3d(uint16_t x, uint16_t y, uint16_t z);
+
+/*
+    Fast xorshift pseudo random number generator
+*/
+void randomSetSeed(uint32_t seed);
+uint32_t random32(void);
+
+static inline uint16_t random16(void) { return random32() >> 16; }
+
+static inline uint8_t random8(void) { return random32() >> 24; }
+
+/* Random number in 0..lim-1 */
+static inline uint8_t random8Limit(uint8_t lim) {
+  return ((uint16_t)random8() * lim) >> 8;
+}
+
+#endif
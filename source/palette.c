@@ -0,0 +1,110 @@
+/*
+    ===  palette  ===
+    Gradient palettes sampled into a small interpolated lookup table.
+*/
+#include "palette.h"
+#include "miniFastLED.h"
+#include "miniLib8tion.h"
+#include "string.h"
+
+led_t paletteTable[PALETTE_SAMPLES];
+uint8_t currentPalette = PALETTE_RAINBOW;
+
+/* Position, R, G, B */
+
+/* The basic colors of the static rainbow profiles, wrapping back to red */
+static const uint8_t rainbowStops[] = {
+    0,   0xcc, 0x00, 0x00, 32,  0xcc, 0xcc, 0x00, 64,  0x5f, 0xcc, 0x00,
+    96,  0x00, 0xc7, 0xcc, 128, 0x00, 0x6e, 0xcc, 160, 0x00, 0x33, 0xff,
+    192, 0x69, 0x00, 0xcc, 224, 0xcc, 0x00, 0xbf, 255, 0xcc, 0x00, 0x00};
+
+static const uint8_t sunsetStops[] = {
+    0,   0x78, 0x00, 0x00, 22,  0xb3, 0x16, 0x00, 51,  0xff, 0x68, 0x00,
+    85,  0xa7, 0x16, 0x12, 135, 0x64, 0x00, 0x67, 198, 0x10, 0x00, 0x82,
+    255, 0x00, 0x00, 0xa0};
+
+static const uint8_t oceanStops[] = {0,   0x00, 0x00, 0x30, 96,  0x00,
+                                     0x40, 0xa0, 160, 0x00, 0xc0, 0xc0,
+                                     255, 0xc0, 0xff, 0xff};
+
+static const uint8_t lavaStops[] = {0,   0x00, 0x00, 0x00, 46,  0x5d,
+                                    0x00, 0x00, 96,  0xbb, 0x00, 0x00,
+                                    180, 0xff, 0x70, 0x00, 255, 0xff,
+                                    0xff, 0xff};
+
+static const uint8_t forestStops[] = {0,   0x00, 0x40, 0x00, 96,  0x20,
+                                      0x80, 0x10, 180, 0x80, 0xa0, 0x00,
+                                      255, 0x00, 0x60, 0x30};
+
+static const struct {
+  const uint8_t *stops;
+  uint8_t size;
+} builtinPalettes[] = {
+    {rainbowStops, sizeof(rainbowStops)}, {sunsetStops, sizeof(sunsetStops)},
+    {oceanStops, sizeof(oceanStops)},     {lavaStops, sizeof(lavaStops)},
+    {forestStops, sizeof(forestStops)},
+};
+
+/* Until uploaded, the custom palette is the rainbow */
+static uint8_t customStops[4 * PALETTE_MAX_STOPS];
+static uint8_t customSize;
+
+static bool validStops(const uint8_t *stops, uint8_t size) {
+  if (size % 4 != 0 || size < 8 || size > sizeof(customStops))
+    return false;
+  if (stops[0] != 0 || stops[size - 4] != 255)
+    return false;
+  for (uint8_t s = 4; s < size; s += 4) {
+    if (stops[s] < stops[s - 4])
+      return false;
+  }
+  return true;
+}
+
+/* Color of the gradient at each sample position, interpolated linearly
+ * between the stops around it */
+static void expandStops(const uint8_t *stops, uint8_t size) {
+  uint8_t s = 0;
+  for (uint8_t i = 0; i < PALETTE_SAMPLES; i++) {
+    const uint8_t pos = i < PALETTE_SAMPLES - 1 ? i * 16 : 255;
+    while (s + 8 < size && stops[s + 4] < pos)
+      s += 4;
+
+    const uint8_t *a = &stops[s];
+    const uint8_t *b = &stops[s + 4];
+    const uint8_t span = b[0] - a[0];
+    const uint8_t frac = span ? (pos - a[0]) * 255u / span : 0;
+    led_t c = {.p.red = lerp8by8(a[1], b[1], frac),
+               .p.green = lerp8by8(a[2], b[2], frac),
+               .p.blue = lerp8by8(a[3], b[3], frac)};
+    naiveDimLed(&c);
+    paletteTable[i] = c;
+  }
+}
+
+void paletteExpand(void) {
+  if (currentPalette == PALETTE_CUSTOM && customSize > 0) {
+    expandStops(customStops, customSize);
+  } else if (currentPalette < PALETTE_CUSTOM) {
+    expandStops(builtinPalettes[currentPalette].stops,
+                builtinPalettes[currentPalette].size);
+  } else {
+    expandStops(rainbowStops, sizeof(rainbowStops));
+  }
+}
+
+bool paletteSelect(uint8_t id) {
+  if (id >= PALETTE_COUNT)
+    return false;
+  currentPalette = id;
+  paletteExpand();
+  return true;
+}
+
+bool paletteUpload(const uint8_t *stops, uint8_t size) {
+  if (!validStops(stops, size))
+    return false;
+  memcpy(customStops, stops, size);
+  customSize = size;
+  return paletteSelect(PALETTE_CUSTOM);
+}
@@ -0,0 +1,54 @@
+#ifndef PALETTE_INCLUDED
+#define PALETTE_INCLUDED
+
+#include "blend.h"
+#include "light_utils.h"
+
+/*
+ * Gradient palettes.
+ *
+ * A palette is a compact list of stops kept in flash, like FastLED gradient
+ * palettes: 4 bytes per stop (position, R, G, B), positions ascending from 0
+ * to 255. The selected palette is sampled every 16 positions into a small
+ * table in RAM, already dimmed to the current intensity, and lookups
+ * interpolate between the two nearest samples - like FastLED's 16-entry
+ * palettes. A full 256-entry table would take 1KB of the 8KB of RAM.
+ */
+
+#define PALETTE_MAX_STOPS 16
+
+typedef enum {
+  PALETTE_RAINBOW = 0,
+  PALETTE_SUNSET,
+  PALETTE_OCEAN,
+  PALETTE_LAVA,
+  PALETTE_FOREST,
+  /* Uploaded with CMD_LED_PALETTE_UPLOAD */
+  PALETTE_CUSTOM,
+  PALETTE_COUNT
+} palette_id;
+
+/* Samples at 0, 16, ..., 240 and 255 */
+#define PALETTE_SAMPLES 17
+
+extern led_t paletteTable[PALETTE_SAMPLES];
+extern uint8_t currentPalette;
+
+/* Smooth color for any 0..255 index */
+static inline uint32_t paletteLookup(uint8_t index) {
+  const led_t *sample = &paletteTable[index >> 4];
+  return blendOpacity(sample[0].rgb, sample[1].rgb, (index & 15) << 4);
+}
+
+/* Sample the current palette into paletteTable. Call on profile init and
+ * when the intensity changes. */
+void paletteExpand(void);
+
+/* Select and expand a palette. Returns false for an unknown id. */
+bool paletteSelect(uint8_t id);
+
+/* Store the custom palette (`size` bytes of stops) and select it. Returns
+ * false if the stops are malformed. */
+bool paletteUpload(const uint8_t *stops, uint8_t size);
+
+#endif
@@ -0,0 +1,50 @@
+/*
+    ===  particles  ===
+    Preallocated particle pool for reactive effects.
+*/
+#include "particles.h"
+
+/* Index of the particle which has the least of its life left */
+static uint8_t evictionVictim(const particle_pool_t *pool) {
+  uint8_t victim = 0;
+  for (uint8_t i = 1; i < pool->count; i++) {
+    const particle_t *p = &pool->items[i];
+    const particle_t *v = &pool->items[victim];
+    /* p->age / p->life > v->age / v->life without a division */
+    if ((uint16_t)p->age * v->life > (uint16_t)v->age * p->life)
+      victim = i;
+  }
+  return victim;
+}
+
+particle_t *particleSpawn(particle_pool_t *pool, uint8_t row, uint8_t col,
+                          uint8_t hue, uint8_t life) {
+  particle_t *p;
+  if (pool->count < MAX_PARTICLES) {
+    p = &pool->items[pool->count++];
+  } else {
+    p = &pool->items[evictionVictim(pool)];
+  }
+
+  p->row = row;
+  p->col = col;
+  p->age = 0;
+  p->life = life ? life : 1;
+  p->hue = hue;
+  p->dx = 0;
+  p->dy = 0;
+  return p;
+}
+
+void particlesUpdate(particle_pool_t *pool) {
+  uint8_t i = 0;
+  while (i < pool->count) {
+    particle_t *p = &pool->items[i];
+    if (++p->age >= p->life) {
+      /* Swap-remove keeps the active particles packed */
+      *p = pool->items[--pool->count];
+    } else {
+      i++;
+    }
+  }
+}
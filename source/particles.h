@@ -0,0 +1,46 @@
+#ifndef PARTICLES_INCLUDED
+#define PARTICLES_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Fixed pool of short-living particles (ripples, splashes, comets) spawned
+ * by keypress handlers. Nothing is allocated at runtime and updating the pool
+ * costs O(active particles), not O(keys).
+ *
+ * When the pool is full, spawning evicts the particle closest to the end of
+ * its life (oldest relative to its lifetime; first in pool order on ties).
+ */
+
+#define MAX_PARTICLES 12
+
+typedef struct {
+  /* Origin of the particle */
+  uint8_t row, col;
+  /* Ticks since spawn and total lifetime in ticks */
+  uint8_t age, life;
+  uint8_t hue;
+  /* Effect specific, eg. direction of a comet */
+  int8_t dx, dy;
+} particle_t;
+
+typedef struct {
+  particle_t items[MAX_PARTICLES];
+  uint8_t count;
+} particle_pool_t;
+
+static inline void particlesClear(particle_pool_t *pool) { pool->count = 0; }
+
+static inline bool particlesEmpty(const particle_pool_t *pool) {
+  return pool->count == 0;
+}
+
+/* Add a particle, evicting one if needed. Never fails. */
+particle_t *particleSpawn(particle_pool_t *pool, uint8_t row, uint8_t col,
+                          uint8_t hue, uint8_t life);
+
+/* Age all particles by one tick and drop the dead ones. */
+void particlesUpdate(particle_pool_t *pool);
+
+#endif
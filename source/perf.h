@@ -0,0 +1,27 @@
+#ifndef PERF_INCLUDED
+#define PERF_INCLUDED
+
+#include "hal.h"
+
+/*
+ * CPU cycle timestamps for measuring render costs.
+ *
+ * Built from the system tick count and the SysTick down-counter, which runs
+ * at the core clock. The PWM interrupt has a higher priority than SysTick, so
+ * a tick may be pending while we measure from it - that case is detected and
+ * compensated once, which keeps measurements exact up to two system ticks
+ * (200us) even inside the interrupt.
+ */
+static inline uint32_t perfNow(void) {
+  const uint32_t reload = SysTick->LOAD + 1;
+  uint32_t ticks = chVTGetSystemTimeX();
+  uint32_t val = SysTick->VAL;
+  if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+    /* Wrapped, but the tick wasn't serviced yet; re-read past the wrap. */
+    val = SysTick->VAL;
+    ticks++;
+  }
+  return ticks * reload + (reload - 1 - val);
+}
+
+#endif
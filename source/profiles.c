@@ -1,6 +1,15 @@
 #include "profiles.h"
+#include "effectVM.h"
+#include "geometry.h"
+#include "keyframes.h"
+#include "keystate.h"
 #include "matrix.h"
 #include "miniFastLED.h"
+#include "miniLib8tion.h"
+#include "palette.h"
+#include "particles.h"
+#include "string.h"
+#include "text.h"
 
 // An array of basic colors used accross different lighting profiles
 // static const uint32_t colorPalette[] = {0xFF0000, 0xF0F00, 0x00F00, 0x00F0F,
@@ -10,6 +19,42 @@ static const uint32_t colorPalette[] = {0xcc0000, 0xcccc00, 0x5fcc00, 0x00c7cc,
 
 #define LEN(a) (sizeof(a) / sizeof(*a))
 
+/*
+ * State of the running profile. Profiles don't keep file-scope state; they
+ * use their member of the profile_state union, which is zeroed and passed
+ * through profileInit on each profile switch.
+ */
+/* Current profile and the outgoing one during a transition */
+static profile_state profileStateArena[2];
+profile_state *profileState = &profileStateArena[0];
+
+/* Keep an eye on the arena - it's the largest member that counts. */
+_Static_assert(sizeof(profile_state) <= PROFILE_STATE_LIMIT,
+               "Profile state doesn't fit in the arena limit");
+
+void resetProfileState(void) {
+  memset(profileState, 0, sizeof(*profileState));
+}
+
+static inline uint32_t skipToRate(uint16_t skip) {
+  return skip ? ANIMATION_PHASE_ONE / skip : 0;
+}
+
+/* Piecewise linear through the four speeds of the profile at 0, 85, 170 and
+ * 255, interpolating steps per frame rather than frames per step. */
+uint32_t profileAnimationRate(const profile *p, uint8_t speed) {
+  const uint8_t segment = speed >= 255 ? 2 : speed / 85;
+  const int32_t t = speed - segment * 85;
+  const int32_t from = skipToRate(p->animationSpeed[segment]);
+  const int32_t to = skipToRate(p->animationSpeed[segment + 1]);
+  return from + (to - from) * t / 85;
+}
+
+profile_state *spareProfileState(void) {
+  return profileState == &profileStateArena[0] ? &profileStateArena[1]
+                                               : &profileStateArena[0];
+}
+
 void red(led_t *currentKeyLedColors) {
   setAllKeysColor(currentKeyLedColors, naiveDimRGB(0xFF0000));
 }
@@ -93,21 +138,20 @@ void rainbowVertical(led_t *currentKeyLedColors) {
   }
 }
 
-static uint8_t colAnimOffset = 0;
 void animatedRainbowVertical(led_t *currentKeyLedColors) {
+  uint8_t *colAnimOffset = &profileState->colAnimOffset;
   for (uint16_t i = 0; i < NUM_COLUMN; ++i) {
     for (uint16_t j = 0; j < NUM_ROW; ++j) {
       setKeyColor(
           &currentKeyLedColors[j * NUM_COLUMN + i],
-          naiveDimRGB(colorPalette[(i + colAnimOffset) % LEN(colorPalette)]));
+          naiveDimRGB(colorPalette[(i + *colAnimOffset) % LEN(colorPalette)]));
     }
   }
-  colAnimOffset = (colAnimOffset + 1) % LEN(colorPalette);
+  *colAnimOffset = (*colAnimOffset + 1) % LEN(colorPalette);
 }
 
-static uint8_t flowValue[NUM_COLUMN] = {0,  11, 22, 33,  44,  55,  66,
-                                        77, 88, 99, 110, 121, 132, 143};
 void animatedRainbowFlow(led_t *currentKeyLedColors) {
+  uint8_t *flowValue = profileState->flowValue;
   for (int i = 0; i < NUM_COLUMN; i++) {
     setColumnColorHSV(currentKeyLedColors, i, flowValue[i], 255, 255);
     if (flowValue[i] >= 179 && flowValue[i] < 240) {
@@ -117,9 +161,15 @@ void animatedRainbowFlow(led_t *currentKeyLedColors) {
   }
 }
 
-static uint8_t waterfallValue[NUM_COLUMN] = {0,  10, 20, 30,  40,  50,  60,
-                                             70, 80, 90, 100, 110, 120, 130};
+void animatedRainbowFlowInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  for (int i = 0; i < NUM_COLUMN; i++) {
+    profileState->flowValue[i] = 11 * i;
+  }
+}
+
 void animatedRainbowWaterfall(led_t *currentKeyLedColors) {
+  uint8_t *waterfallValue = profileState->waterfallValue;
   for (int i = 0; i < NUM_ROW; i++) {
     setRowColorHSV(currentKeyLedColors, i, waterfallValue[i], 255, 125);
     if (waterfallValue[i] >= 179 && waterfallValue[i] < 240) {
@@ -129,35 +179,54 @@ void animatedRainbowWaterfall(led_t *currentKeyLedColors) {
   }
 }
 
-static uint8_t breathingValue = 180;
-static int breathingDirection = -1;
+void animatedRainbowWaterfallInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  for (int i = 0; i < NUM_ROW; i++) {
+    profileState->waterfallValue[i] = 10 * i;
+  }
+}
+
 void animatedBreathing(led_t *currentKeyLedColors) {
-  setAllKeysColorHSV(currentKeyLedColors, 85, 255, breathingValue);
-  if (breathingValue >= 180) {
-    breathingDirection = -2;
-  } else if (breathingValue <= 2) {
-    breathingDirection = 2;
+  uint8_t *breathingValue = &profileState->bounce.value;
+  int8_t *breathingDirection = &profileState->bounce.direction;
+  setAllKeysColorHSV(currentKeyLedColors, 85, 255, *breathingValue);
+  if (*breathingValue >= 180) {
+    *breathingDirection = -2;
+  } else if (*breathingValue <= 2) {
+    *breathingDirection = 2;
   }
-  breathingValue += breathingDirection;
+  *breathingValue += *breathingDirection;
+}
+
+void animatedBreathingInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  profileState->bounce.value = 180;
+  profileState->bounce.direction = -1;
 }
 
-static uint8_t spectrumValue = 2;
-static int spectrumDirection = 1;
 void animatedSpectrum(led_t *currentKeyLedColors) {
-  setAllKeysColorHSV(currentKeyLedColors, spectrumValue, 255, 125);
-  if (spectrumValue >= 177) {
-    spectrumDirection = -3;
-  } else if (spectrumValue <= 2) {
-    spectrumDirection = 3;
+  uint8_t *spectrumValue = &profileState->bounce.value;
+  int8_t *spectrumDirection = &profileState->bounce.direction;
+  setAllKeysColorHSV(currentKeyLedColors, *spectrumValue, 255, 125);
+  if (*spectrumValue >= 177) {
+    *spectrumDirection = -3;
+  } else if (*spectrumValue <= 2) {
+    *spectrumDirection = 3;
   }
-  spectrumValue += spectrumDirection;
+  *spectrumValue += *spectrumDirection;
 }
 
-static uint8_t waveValue[NUM_COLUMN] = {0,  0,  0,  10,  15,  20,  25,
-                                        40, 55, 75, 100, 115, 135, 140};
-static int waveDirection[NUM_COLUMN] = {3, 3, 3, 3, 3, 3, 3,
-                                        3, 3, 3, 3, 3, 3, 3};
+void animatedSpectrumInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  profileState->bounce.value = 2;
+  profileState->bounce.direction = 1;
+}
+
+static const uint8_t waveStart[NUM_COLUMN] = {0,  0,  0,  10,  15,  20,  25,
+                                              40, 55, 75, 100, 115, 135, 140};
 void animatedWave(led_t *currentKeyLedColors) {
+  uint8_t *waveValue = profileState->wave.value;
+  int8_t *waveDirection = profileState->wave.direction;
   for (int i = 0; i < NUM_COLUMN; i++) {
     if (waveValue[i] >= 140) {
       waveDirection[i] = -3;
@@ -169,63 +238,132 @@ void animatedWave(led_t *currentKeyLedColors) {
   }
 }
 
-uint8_t animatedPressedBuf[NUM_ROW * NUM_COLUMN] = {0};
+void animatedWaveInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  for (int i = 0; i < NUM_COLUMN; i++) {
+    profileState->wave.value[i] = waveStart[i];
+    profileState->wave.direction[i] = 3;
+  }
+}
+
+/* Sum of three sine waves moving at different speeds - no floats needed */
+void animatedPlasma(led_t *currentKeyLedColors) {
+  const uint16_t plasmaTime = profileState->time;
+  const uint8_t t = plasmaTime;
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint8_t col = 0; col < NUM_COLUMN; col++) {
+      const uint16_t v = sin8(col * 16 + t) + sin8(row * 40 + (t >> 1)) +
+                         sin8((col + row) * 12 + (plasmaTime >> 2));
+      currentKeyLedColors[ROWCOL2IDX(row, col)].rgb = paletteLookup(v / 3);
+    }
+  }
+  profileState->time += 2;
+}
+
+/* Selected gradient palette flowing across the board */
+void animatedGradient(led_t *currentKeyLedColors) {
+  const uint8_t offset = profileState->time;
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint8_t col = 0; col < NUM_COLUMN; col++) {
+      currentKeyLedColors[ROWCOL2IDX(row, col)].rgb =
+          paletteLookup(col * 12 + row * 6 - offset);
+    }
+  }
+  profileState->time += 1;
+}
+
+/* Shared by the profiles which color keys from the palette table */
+void paletteProfileInit(led_t *currentKeyLedColors) {
+  (void)currentKeyLedColors;
+  paletteExpand();
+}
+
+/* Rainbow spiral turning around the board centre */
+void animatedSpiral(led_t *currentKeyLedColors) {
+  const uint8_t spiralOffset = profileState->time;
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    if (keyCenterDistance[i] == GEO_INVALID)
+      continue;
+    hsv2rgb(keyCenterAngle[i] + 2 * keyCenterDistance[i] + spiralOffset, 255,
+            255, &currentKeyLedColors[i]);
+  }
+  profileState->time -= 2;
+}
+
+/* Hue moves from red to green as the value decays from FADE_START to 0 */
+#define FADE_START 100
+#define FADE_STEP 5
 
 void reactiveFade(led_t *ledColors) {
-  for (int i = 0; i < NUM_ROW * NUM_COLUMN; i++) {
-    if (animatedPressedBuf[i] > 5) {
-      animatedPressedBuf[i] -= 5;
-      hsv2rgb(100 - animatedPressedBuf[i], 255, 225, &ledColors[i]);
-    } else if (animatedPressedBuf[i] > 0) {
-      ledColors[i].p.blue = 0;
-      ledColors[i].p.red = 0;
-      ledColors[i].p.green = 0;
-      animatedPressedBuf[i] = 0;
+  active_set_t *active = &profileState->active;
+  if (active->count == 0)
+    return;
+
+  active->now++;
+  uint8_t pos = 0;
+  while (pos < active->count) {
+    const uint8_t key = active->keys[pos];
+    const int16_t value = FADE_START - FADE_STEP * activeSetAge(active, key);
+    if (value > 0) {
+      hsv2rgb(FADE_START - value, 255, 225, &ledColors[key]);
+      pos++;
+    } else {
+      ledColors[key].rgb = 0;
+      activeSetRemoveAt(active, pos);
     }
   }
 }
 
 void reactiveFadeKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  active_set_t *active = &profileState->active;
   int i = row * NUM_COLUMN + col;
-  animatedPressedBuf[i] = 100;
+  activeSetAdd(active, i, active->now);
   ledColors[i].p.green = 0;
   ledColors[i].p.red = 0xFF;
   ledColors[i].p.blue = 0;
 }
 
 void reactiveFadeInit(led_t *ledColors) {
+  active_set_t *active = &profileState->active;
   // create a quick "falling" animation to make it easier to see
-  // that this profile is activated
+  // that this profile is activated: lower rows start further into the fade
   for (int i = 0; i < NUM_ROW; i++) {
     for (int j = 0; j < NUM_COLUMN; j++) {
-      animatedPressedBuf[i * NUM_COLUMN + j] = i * 15 + 25;
+      activeSetAdd(active, i * NUM_COLUMN + j, active->now - (15 - 3 * i));
     }
   }
   setAllKeysToBlank(ledColors);
 }
 
-uint8_t pulseBuf[NUM_ROW];
+/* Rows are lit for PULSE_START / PULSE_STEP ticks after a keypress */
+#define PULSE_START 80
+#define PULSE_STEP 16
+
+static inline void paintRow(led_t *ledColors, uint8_t row, uint8_t blue) {
+  for (int j = 0; j < NUM_COLUMN; j++) {
+    ledColors[row * NUM_COLUMN + j].rgb = blue;
+  }
+}
 
 void reactivePulse(led_t *ledColors) {
-  uint8_t pulseSpeed = 16;
+  active_set_t *active = &profileState->active;
+  if (active->count == 0)
+    return;
 
-  for (int i = 0; i < NUM_ROW; i++) {
-    if (pulseBuf[i] > 80) {
-      pulseBuf[i] -= pulseSpeed;
-    } else if (pulseBuf[i] > pulseSpeed) {
-      for (int j = 0; j < NUM_COLUMN; j++) {
-        ledColors[i * NUM_COLUMN + j].p.blue = (175 + pulseBuf[i]);
-        ledColors[i * NUM_COLUMN + j].p.red = 0;
-        ledColors[i * NUM_COLUMN + j].p.green = 0;
-      }
-      pulseBuf[i] -= pulseSpeed;
-    } else if (pulseBuf[i] > 0) {
-      pulseBuf[i] = 0;
-      for (int j = 0; j < NUM_COLUMN; j++) {
-        ledColors[i * NUM_COLUMN + j].p.blue = 0;
-        ledColors[i * NUM_COLUMN + j].p.red = 0;
-        ledColors[i * NUM_COLUMN + j].p.green = 0;
-      }
+  active->now++;
+  uint8_t pos = 0;
+  while (pos < active->count) {
+    const uint8_t row = active->keys[pos];
+    const int16_t value = PULSE_START - PULSE_STEP * activeSetAge(active, row);
+    if (value >= PULSE_START) {
+      /* Not started yet */
+      pos++;
+    } else if (value > 0) {
+      paintRow(ledColors, row, 175 + PULSE_STEP + value);
+      pos++;
+    } else {
+      paintRow(ledColors, row, 0);
+      activeSetRemoveAt(active, pos);
     }
   }
 }
@@ -234,14 +372,159 @@ void reactivePulseKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
   (void)ledColors;
   (void)col;
 
-  pulseBuf[row] = 80;
+  activeSetAdd(&profileState->active, row, profileState->active.now);
 }
 
 void reactivePulseInit(led_t *ledColors) {
+  active_set_t *active = &profileState->active;
+  /* Cascade down, one tick per row */
   for (int i = 0; i < NUM_ROW; i++) {
-    pulseBuf[i] = 80 + i * 5;
+    activeSetAdd(active, i, active->now + i);
+  }
+  setAllKeysToBlank(ledColors);
+}
+
+/*
+ * Keys glow while held, shifting from blue to red the longer they're held,
+ * and fade out after release.
+ */
+
+/* Decay of released keys per tick, they're dropped after HOLD_FADE_TICKS */
+#define HOLD_FADE 200
+#define HOLD_FADE_TICKS 24
+
+void reactiveHold(led_t *ledColors) {
+  active_set_t *active = &profileState->active;
+
+  /* Held keys stay at age 0, so the age of a released key counts from its
+   * release. */
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint16_t bits = pressedKeys.rows[row]; bits; bits &= bits - 1) {
+      activeSetAdd(active, ROWCOL2IDX(row, bitboardLowest(bits)), active->now);
+    }
+  }
+  if (active->count == 0)
+    return;
+
+  uint8_t pos = 0;
+  while (pos < active->count) {
+    const uint8_t key = active->keys[pos];
+    const int8_t age = activeSetAge(active, key);
+    led_t *color = &ledColors[key];
+    if (age == 0) {
+      const uint16_t held = keyHeldFrames(key);
+      hsv2rgb(held >= 80 ? 0 : 160 - 2 * held, 255, 255, color);
+      pos++;
+    } else if (age < HOLD_FADE_TICKS) {
+      color->p.red = scale8(color->p.red, HOLD_FADE);
+      color->p.green = scale8(color->p.green, HOLD_FADE);
+      color->p.blue = scale8(color->p.blue, HOLD_FADE);
+      pos++;
+    } else {
+      color->rgb = 0;
+      activeSetRemoveAt(active, pos);
+    }
+  }
+  active->now++;
+}
+
+void reactiveHoldKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  active_set_t *active = &profileState->active;
+  const uint8_t key = ROWCOL2IDX(row, col);
+  activeSetAdd(active, key, active->now);
+  hsv2rgb(160, 255, 255, &ledColors[key]);
+}
+
+/*
+ * Conway's game of life on the key matrix, seeded by keypresses. Cells are
+ * colored from the palette by column and generation.
+ */
+void reactiveLife(led_t *ledColors) {
+  bitboard_t *cells = &profileState->life.cells;
+
+  /* Died out and the board is already blank */
+  if (bitboardEmpty(cells) && !profileState->life.visible)
+    return;
+
+  const uint8_t generation = profileState->life.generation++;
+  setAllKeysToBlank(ledColors);
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint16_t bits = cells->rows[row]; bits; bits &= bits - 1) {
+      const uint8_t col = bitboardLowest(bits);
+      ledColors[ROWCOL2IDX(row, col)].rgb =
+          paletteLookup(col * 12 + generation * 4);
+    }
+  }
+  profileState->life.visible = !bitboardEmpty(cells);
+
+  /* Born with 3 neighbours, survives with 2 or 3 */
+  bitboard_t count[3];
+  bitboardNeighbours(cells, count);
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    const uint16_t twoOrThree = count[1].rows[row] & ~count[2].rows[row];
+    const uint16_t three = twoOrThree & count[0].rows[row];
+    cells->rows[row] = three | (cells->rows[row] & twoOrThree);
+  }
+  bitboardMask(cells, validKeyRows);
+}
+
+void reactiveLifeKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  (void)ledColors;
+  bitboard_t *cells = &profileState->life.cells;
+  /* The key and a random half of its neighbours */
+  const uint8_t pattern = random8();
+  uint8_t bit = 0;
+  for (int8_t r = row - 1; r <= row + 1; r++) {
+    for (int8_t c = col - 1; c <= col + 1; c++) {
+      if (r == row && c == col)
+        continue;
+      const bool seed = pattern & (1 << bit++);
+      if (seed && r >= 0 && r < NUM_ROW && c >= 0 && c < NUM_COLUMN)
+        bitboardSet(cells, r, c);
+    }
   }
+  bitboardSet(cells, row, col);
+  bitboardMask(cells, validKeyRows);
+}
+
+/*
+ * Waves spreading from the pressed keys through an excitable medium: a ready
+ * key next to a firing one fires, then rests for a generation.
+ */
+void reactiveWaves(led_t *ledColors) {
+  bitboard_t *firing = &profileState->waves.firing;
+  bitboard_t *refractory = &profileState->waves.refractory;
+
+  if (bitboardEmpty(firing) && bitboardEmpty(refractory))
+    return;
+
   setAllKeysToBlank(ledColors);
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    for (uint16_t bits = firing->rows[row]; bits; bits &= bits - 1) {
+      hsv2rgb(profileState->waves.hue, 255, 255,
+              &ledColors[ROWCOL2IDX(row, bitboardLowest(bits))]);
+    }
+    for (uint16_t bits = refractory->rows[row]; bits; bits &= bits - 1) {
+      hsv2rgb(profileState->waves.hue, 255, 64,
+              &ledColors[ROWCOL2IDX(row, bitboardLowest(bits))]);
+    }
+  }
+
+  bitboard_t next;
+  bitboardDilate(firing, &next);
+  for (uint8_t row = 0; row < NUM_ROW; row++) {
+    next.rows[row] &= ~firing->rows[row] & ~refractory->rows[row];
+  }
+  bitboardMask(&next, validKeyRows);
+  *refractory = *firing;
+  *firing = next;
+}
+
+void reactiveWavesKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  (void)ledColors;
+  if (!bitboardTest(&profileState->waves.refractory, row, col))
+    bitboardSet(&profileState->waves.firing, row, col);
+  profileState->waves.hue = random8();
 }
 
 /*
@@ -257,73 +540,156 @@ void lazyMark(led_t *ledColors, int8_t row, int8_t col, const led_t color) {
   ledColors[ROWCOL2IDX(row, col)] = color;
 }
 
-int8_t rowBlink = -1;
-int8_t termPos;
-uint16_t termAnim;
-
 void reactiveTerm(led_t *ledColors) {
+  term_state *term = &profileState->term;
   led_t color;
   color.rgb = 0;
   setAllKeysToBlank(ledColors);
 
-  if (termPos < 0) {
+  if (term->pos < 0) {
     color.p.red = 255;
     naiveDimLed(&color);
-    lazyMark(ledColors, 0, -termPos, color);
-    lazyMark(ledColors, 0, -termPos + 1, color);
-    termPos += 2;
+    lazyMark(ledColors, 0, -term->pos, color);
+    lazyMark(ledColors, 0, -term->pos + 1, color);
+    term->pos += 2;
     return;
   }
 
-  if (rowBlink != -1) {
+  if (term->rowBlink != -1) {
     color.p.red = 0;
     color.p.green = 255;
     naiveDimLed(&color);
     for (int col = 0; col < NUM_COLUMN; col++) {
-      lazyMark(ledColors, rowBlink, col, color);
+      lazyMark(ledColors, term->rowBlink, col, color);
     }
 
-    rowBlink = -1;
+    term->rowBlink = -1;
   }
 
   /* 70*14 times per second */
-  termAnim++;
-  if (termAnim > 140)
-    termAnim = 0;
+  term->anim++;
+  if (term->anim > 140)
+    term->anim = 0;
   int16_t brightness = 0;
 
-  if (termAnim < 70) {
-    brightness = termAnim * 51; /* full in 5 frames */
+  if (term->anim < 70) {
+    brightness = term->anim * 51; /* full in 5 frames */
     if (brightness > 255)
       brightness = 255;
   } else {
     /* Starts with 70 */
-    brightness = 255 - (termAnim - 70) * 51;
+    brightness = 255 - (term->anim - 70) * 51;
     if (brightness < 0)
       brightness = 0;
   }
   color.p.green = 0;
   color.p.red = brightness;
   naiveDimLed(&color);
-  lazyMark(ledColors, 0, termPos, color);
+  lazyMark(ledColors, 0, term->pos, color);
 }
 
 void reactiveTermKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  term_state *term = &profileState->term;
   (void)row;
   (void)col;
-  if (termPos >= 0) {
-    termPos = (termPos + 1);
-    if (termPos == 13) {
-      termPos = -14;
+  if (term->pos >= 0) {
+    term->pos = (term->pos + 1);
+    if (term->pos == 13) {
+      term->pos = -14;
     }
   }
-  termAnim = 0;
-  rowBlink = row;
+  term->anim = 0;
+  term->rowBlink = row;
   setAllKeysToBlank(ledColors);
 }
 
 void reactiveTermInit(led_t *ledColors) {
-  termPos = 0;
-  termAnim = 0;
+  term_state *term = &profileState->term;
+  term->rowBlink = -1;
+  term->pos = 0;
+  term->anim = 0;
+  setAllKeysToBlank(ledColors);
+}
+
+/*
+ * Ripples spreading from the pressed keys
+ */
+
+/* Draw a ring one key wide, growing by half a key each tick */
+static void drawRipple(led_t *ledColors, const particle_t *p) {
+  const uint8_t origin = ROWCOL2IDX(p->row, p->col);
+  const uint16_t radius = p->age * (GEO_UNIT / 2);
+  const uint8_t val = 255 - (uint16_t)p->age * 255 / p->life;
+  led_t color;
+  hsv2rgb(p->hue, 255, val, &color);
+
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    const uint8_t d = keyDistance(origin, i);
+    if (d != GEO_INVALID && d + GEO_UNIT / 2 >= radius &&
+        d < radius + GEO_UNIT / 2)
+      ledColors[i] = color;
+  }
+}
+
+void reactiveRipple(led_t *ledColors) {
+  particle_pool_t *ripples = &profileState->ripple.pool;
+
+  /* Nothing to animate and the board is already blank */
+  if (particlesEmpty(ripples) && !profileState->ripple.visible)
+    return;
+
+  setAllKeysToBlank(ledColors);
+  for (uint8_t i = 0; i < ripples->count; i++) {
+    drawRipple(ledColors, &ripples->items[i]);
+  }
+  profileState->ripple.visible = !particlesEmpty(ripples);
+  particlesUpdate(ripples);
+}
+
+void reactiveRippleKeypress(led_t *ledColors, uint8_t row, uint8_t col) {
+  (void)ledColors;
+  particleSpawn(&profileState->ripple.pool, row, col, random8(),
+                2 * NUM_COLUMN);
+}
+
+void reactiveRippleInit(led_t *ledColors) {
+  /* Pool is already empty after the state reset */
   setAllKeysToBlank(ledColors);
 }
+
+/*
+ * Effect uploaded over the protocol and run by the effect VM
+ */
+void vmEffect(led_t *ledColors) { vmRender(&profileState->vm, ledColors); }
+
+void vmEffectInit(led_t *ledColors) {
+  vmReset(&profileState->vm);
+  setAllKeysToBlank(ledColors);
+}
+
+/*
+ * Keyframe animation flashed behind the firmware
+ */
+void animationPlayback(led_t *ledColors) {
+  keyframesRender(&profileState->keyframes, ledColors);
+}
+
+void animationPlaybackInit(led_t *ledColors) {
+  keyframesRewind(&profileState->keyframes);
+  setAllKeysToBlank(ledColors);
+}
+
+/*
+ * Text entering from the right edge and leaving on the left, then starting
+ * over. Usually run in a layer.
+ */
+void textScroll(led_t *ledColors) {
+  const int16_t x = profileState->scrollX;
+  textScrollRender(ledColors, x);
+  profileState->scrollX = x <= -textScrollWidth() ? NUM_COLUMN : x - 1;
+}
+
+void textScrollInit(led_t *ledColors) {
+  (void)ledColors;
+  profileState->scrollX = NUM_COLUMN;
+}
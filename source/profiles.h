@@ -1,11 +1,93 @@
+#ifndef PROFILES_INCLUDED
+#define PROFILES_INCLUDED
+
+#include "activeSet.h"
+#include "bitboard.h"
+#include "effectVM.h"
+#include "keyframes.h"
 #include "light_utils.h"
 #include "matrix.h"
+#include "particles.h"
 #include "settings.h"
 
-/* Update ticks based on profile settings */
+/*
+ * Profile state arena
+ *
+ * Only one profile runs at a time, so their state shares a single union
+ * instead of staying resident in file-scope variables. The arena is zeroed
+ * on each profile switch before profileInit is called; profiles which need
+ * non-zero initial values must set them in their profileInit.
+ *
+ * There are two slots: while a transition fades out the previous profile,
+ * it keeps running from the other one, which also lets it resume if it's
+ * switched back to (see transition.h).
+ */
+
+/* Upper bound of the arena size, checked at compile time */
+#define PROFILE_STATE_LIMIT 160
+
+typedef struct {
+  int8_t rowBlink;
+  int8_t pos;
+  uint16_t anim;
+} term_state;
+
+typedef union {
+  uint8_t colAnimOffset;
+  uint8_t flowValue[NUM_COLUMN];
+  uint8_t waterfallValue[NUM_ROW];
+  /* Breathing, spectrum */
+  struct {
+    uint8_t value;
+    int8_t direction;
+  } bounce;
+  struct {
+    uint8_t value[NUM_COLUMN];
+    int8_t direction[NUM_COLUMN];
+  } wave;
+  /* Plasma, spiral */
+  uint16_t time;
+  /* Reactive fade and hold (keys), reactive pulse (rows) */
+  active_set_t active;
+  term_state term;
+  struct {
+    particle_pool_t pool;
+    bool visible;
+  } ripple;
+  /* Game of life */
+  struct {
+    bitboard_t cells;
+    uint8_t generation;
+    bool visible;
+  } life;
+  /* Excitable medium: firing cells excite their ready neighbours */
+  struct {
+    bitboard_t firing;
+    bitboard_t refractory;
+    uint8_t hue;
+  } waves;
+  /* Text scroll position, leftmost column of the text */
+  int16_t scrollX;
+  vm_state_t vm;
+  keyframes_player_t keyframes;
+} profile_state;
+
+/* State of the currently rendered profile */
+extern profile_state *profileState;
+
+/* Zero the state before initializing a new profile */
+void resetProfileState(void);
+
+/* The arena slot not used by the current profile */
+profile_state *spareProfileState(void);
+
+/* Phase step per frame of a profile at a 0-255 speed, see settings.h */
+uint32_t profileAnimationRate(const profile *p, uint8_t speed);
+
+/* Update the animation rate based on profile settings */
 static inline void updateAnimationSpeed(void) {
-  animationSkipTicks = profiles[currentProfile].animationSpeed[currentSpeed];
-  animationTicks = 0;
+  animationRate = profileAnimationRate(&profiles[currentProfile], currentSpeed);
+  animationPhase = 0;
 }
 
 /*
@@ -25,10 +107,21 @@ void miamiNights(led_t *currentKeyLedColors);
  */
 void animatedRainbowVertical(led_t *currentKeyLedColors);
 void animatedRainbowFlow(led_t *currentKeyLedColors);
+void animatedRainbowFlowInit(led_t *currentKeyLedColors);
 void animatedRainbowWaterfall(led_t *currentKeyLedColors);
+void animatedRainbowWaterfallInit(led_t *currentKeyLedColors);
 void animatedBreathing(led_t *currentKeyLedColors);
+void animatedBreathingInit(led_t *currentKeyLedColors);
 void animatedSpectrum(led_t *currentKeyLedColors);
+void animatedSpectrumInit(led_t *currentKeyLedColors);
 void animatedWave(led_t *currentKeyLedColors);
+void animatedWaveInit(led_t *currentKeyLedColors);
+void animatedPlasma(led_t *currentKeyLedColors);
+void animatedSpiral(led_t *currentKeyLedColors);
+void animatedGradient(led_t *currentKeyLedColors);
+
+/* Expands the palette table for the profiles using it */
+void paletteProfileInit(led_t *currentKeyLedColors);
 
 /*
  * ANIMATED - responding to key presses
@@ -44,3 +137,36 @@ void reactivePulseInit(led_t *ledColors);
 void reactiveTerm(led_t *ledColors);
 void reactiveTermKeypress(led_t *ledColors, uint8_t row, uint8_t col);
 void reactiveTermInit(led_t *ledColors);
+
+void reactiveRipple(led_t *ledColors);
+void reactiveRippleKeypress(led_t *ledColors, uint8_t row, uint8_t col);
+void reactiveRippleInit(led_t *ledColors);
+
+void reactiveHold(led_t *ledColors);
+void reactiveHoldKeypress(led_t *ledColors, uint8_t row, uint8_t col);
+
+void reactiveLife(led_t *ledColors);
+void reactiveLifeKeypress(led_t *ledColors, uint8_t row, uint8_t col);
+
+void reactiveWaves(led_t *ledColors);
+void reactiveWavesKeypress(led_t *ledColors, uint8_t row, uint8_t col);
+
+/*
+ * PROGRAMMABLE - runs a program uploaded with CMD_LED_VM_LOAD
+ */
+void vmEffect(led_t *ledColors);
+void vmEffectInit(led_t *ledColors);
+
+/*
+ * PLAYBACK - animation stored in flash, see source/keyframes.h
+ */
+void animationPlayback(led_t *ledColors);
+void animationPlaybackInit(led_t *ledColors);
+
+/*
+ * TEXT - scrolling text set over the protocol, see source/text.h
+ */
+void textScroll(led_t *ledColors);
+void textScrollInit(led_t *ledColors);
+
+#endif
@@ -10,53 +10,306 @@
  *
  * At 115200, transmitting the shortest message takes 0.043ms, at 9600 - 0.52ms.
  *
+ * protoConsumeBuffer is the fast path for received bursts: frames which are
+ * whole in the buffer are not copied, the callback gets a view into it, and
+ * damaged ones are rejected without going through the state machine.
+ *
+ * With PROTO_FEATURE_CRC negotiated, frames end with a CRC-8 (poly 0x07) of
+ * everything after the first sync byte. Messages sent with retries are then
+ * acknowledged by the receiver instead of being repeated blindly: up to
+ * PROTO_WINDOW of them can wait for an ACK at once, and are sent again on a
+ * NACK or after PROTO_ACK_TIMEOUT_MS.
  */
 
 #include "protocol.h"
 #include "board.h"
 #include "ch.h"
 #include "hal.h"
+#include <stddef.h>
+#include <string.h>
+
+/* protoConsumeBuffer passes the frame header as a message_t */
+_Static_assert(offsetof(message_t, msgId) == 1 &&
+                   offsetof(message_t, payloadSize) == 2 &&
+                   offsetof(message_t, payload) == 3,
+               "message_t must have the layout of the frame header");
 
 /* UART communication protocol state */
 protocol_t proto;
 
-void protoInit(protocol_t *proto, void (*callback)(const message_t *)) {
+static const uint8_t crc8Table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 0x38, 0x3F, 0x36, 0x31,
+    0x24, 0x23, 0x2A, 0x2D, 0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+    0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D, 0xE0, 0xE7, 0xEE, 0xE9,
+    0xFC, 0xFB, 0xF2, 0xF5, 0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85, 0xA8, 0xAF, 0xA6, 0xA1,
+    0xB4, 0xB3, 0xBA, 0xBD, 0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+    0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA, 0xB7, 0xB0, 0xB9, 0xBE,
+    0xAB, 0xAC, 0xA5, 0xA2, 0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32, 0x1F, 0x18, 0x11, 0x16,
+    0x03, 0x04, 0x0D, 0x0A, 0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+    0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A, 0x89, 0x8E, 0x87, 0x80,
+    0x95, 0x92, 0x9B, 0x9C, 0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC, 0xC1, 0xC6, 0xCF, 0xC8,
+    0xDD, 0xDA, 0xD3, 0xD4, 0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+    0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44, 0x19, 0x1E, 0x17, 0x10,
+    0x05, 0x02, 0x0B, 0x0C, 0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B, 0x76, 0x71, 0x78, 0x7F,
+    0x6A, 0x6D, 0x64, 0x63, 0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+    0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13, 0xAE, 0xA9, 0xA0, 0xA7,
+    0xB2, 0xB5, 0xBC, 0xBB, 0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB, 0xE6, 0xE1, 0xE8, 0xEF,
+    0xFA, 0xFD, 0xF4, 0xF3};
+
+static inline uint8_t crc8(uint8_t crc, const uint8_t *data, size_t len) {
+  while (len--)
+    crc = crc8Table[crc ^ *data++];
+  return crc;
+}
+
+/* Reliable message waiting for an ACK */
+typedef struct {
+  bool used;
+  uint8_t command;
+  uint8_t msgId;
+  uint8_t payloadSize;
+  /* Transmissions left */
+  uint8_t retries;
+  systime_t sent;
+  uint8_t payload[PROTO_WINDOW_PAYLOAD];
+} tx_slot_t;
+
+static tx_slot_t window[PROTO_WINDOW];
+
+/* Frames and the window can be sent from more threads */
+static MUTEX_DECL(txMutex);
+
+void protoInit(protocol_t *proto, bool (*callback)(const message_t *)) {
   proto->previousId = 0;
   proto->callback = callback;
   proto->state = STATE_SYNC_1;
   proto->errors = 0;
+  proto->features = 0;
+}
+
+void protoSetFeatures(protocol_t *proto, uint8_t features) {
+  proto->features = features;
+  /* Start over with the next message */
+  proto->seen = 0;
+  if (!(features & PROTO_FEATURE_CRC)) {
+    /* No ACKs will come */
+    chMtxLock(&txMutex);
+    for (uint8_t i = 0; i < PROTO_WINDOW; i++) {
+      window[i].used = false;
+    }
+    chMtxUnlock(&txMutex);
+  }
+}
+
+static void txFrame(uint8_t sync, uint8_t cmd, uint8_t id,
+                    const unsigned char *buf, uint8_t payloadSize) {
+  const uint8_t header[5] = {
+      PROTO_SYNC_1, sync, cmd, id, payloadSize,
+  };
+
+  sdWrite(&PROTOCOL_SD, header, sizeof(header));
+  if (payloadSize)
+    sdWrite(&PROTOCOL_SD, buf, payloadSize);
+  if (proto.features & PROTO_FEATURE_CRC) {
+    const uint8_t crc = crc8(crc8(0, &header[1], 4), buf, payloadSize);
+    sdWrite(&PROTOCOL_SD, &crc, 1);
+  }
+}
+
+static inline void txSlot(tx_slot_t *slot) {
+  slot->retries--;
+  slot->sent = chVTGetSystemTimeX();
+  txFrame(PROTO_SYNC_2_ACK, slot->command, slot->msgId, slot->payload,
+          slot->payloadSize);
 }
 
 static uint8_t msgId = 0;
 void protoTx(uint8_t cmd, const unsigned char *buf, int payloadSize,
              int retries) {
   chDbgCheck(payloadSize <= MAX_PAYLOAD_SIZE);
+  chMtxLock(&txMutex);
+  const uint8_t id = ++msgId;
 
-  const uint8_t header[5] = {
-      0x7A, 0x1D, cmd, ++msgId, payloadSize,
-  };
+  if ((proto.features & PROTO_FEATURE_CRC) && retries > 1 &&
+      payloadSize <= PROTO_WINDOW_PAYLOAD) {
+    for (uint8_t i = 0; i < PROTO_WINDOW; i++) {
+      tx_slot_t *slot = &window[i];
+      if (slot->used)
+        continue;
+      slot->used = true;
+      slot->command = cmd;
+      slot->msgId = id;
+      slot->payloadSize = payloadSize;
+      slot->retries = retries;
+      if (payloadSize)
+        memcpy(slot->payload, buf, payloadSize);
+      txSlot(slot);
+      chMtxUnlock(&txMutex);
+      return;
+    }
+  }
 
-  /* We don't implement ACKs, yet some messages should not be lost. */
+  /* Without ACKs (or with the window full) some messages should still not be
+   * lost - repeat them. */
   for (int i = 0; i < retries; i++) {
-    sdWrite(&PROTOCOL_SD, header, sizeof(header));
-    if (payloadSize)
-      sdWrite(&PROTOCOL_SD, buf, payloadSize);
+    txFrame(PROTO_SYNC_2, cmd, id, buf, payloadSize);
+  }
+  chMtxUnlock(&txMutex);
+}
+
+/* Handle an ACK or NACK of a reliable message */
+static void txAcknowledged(uint8_t id, bool received) {
+  chMtxLock(&txMutex);
+  for (uint8_t i = 0; i < PROTO_WINDOW; i++) {
+    tx_slot_t *slot = &window[i];
+    if (!slot->used || slot->msgId != id)
+      continue;
+    if (received) {
+      slot->used = false;
+    } else if (slot->retries > 0) {
+      txSlot(slot);
+    } else {
+      slot->used = false;
+      proto.errors++;
+    }
+    break;
+  }
+  chMtxUnlock(&txMutex);
+}
+
+/* ACK or NACK a received message */
+static void txAnswer(uint8_t cmd, uint8_t id) {
+  chMtxLock(&txMutex);
+  txFrame(PROTO_SYNC_2, cmd, ++msgId, &id, 1);
+  chMtxUnlock(&txMutex);
+}
+
+bool protoTxPoll(void) {
+  bool waiting = false;
+  chMtxLock(&txMutex);
+  for (uint8_t i = 0; i < PROTO_WINDOW; i++) {
+    tx_slot_t *slot = &window[i];
+    if (!slot->used)
+      continue;
+    const sysinterval_t elapsed = chVTTimeElapsedSinceX(slot->sent);
+    if (elapsed >= TIME_MS2I(PROTO_ACK_TIMEOUT_MS)) {
+      if (slot->retries == 0) {
+        /* Lost */
+        slot->used = false;
+        proto.errors++;
+        continue;
+      }
+      txSlot(slot);
+    }
+    waiting = true;
+  }
+  chMtxUnlock(&txMutex);
+  return waiting;
+}
+
+static inline bool isDuplicate(protocol_t *proto, uint8_t id) {
+  if (!(proto->features & PROTO_FEATURE_CRC)) {
+    /* Resends follow the original */
+    if (id == proto->previousId)
+      return true;
+    proto->previousId = id;
+    return false;
+  }
+
+  /* Resends can come out of order; remember the last 32 ids */
+  const uint8_t age = proto->previousId - id;
+  if (proto->seen != 0 && age < 32) {
+    if (proto->seen & (1ul << age))
+      return true;
+    proto->seen |= 1ul << age;
+  } else if (proto->seen != 0 && age >= 128) {
+    /* Newer than the previous one */
+    const uint8_t ahead = id - proto->previousId;
+    proto->seen = ahead < 32 ? (proto->seen << ahead) | 1 : 1;
+    proto->previousId = id;
+  } else {
+    /* First one, or too old to tell - the sender has probably restarted */
+    proto->seen = 1;
+    proto->previousId = id;
+  }
+  return false;
+}
+
+/* Undo isDuplicate for a message which wasn't taken, so its resend is */
+static inline void forgetId(protocol_t *proto, uint8_t id) {
+  if (!(proto->features & PROTO_FEATURE_CRC)) {
+    proto->previousId = id - 1;
+    return;
+  }
+  const uint8_t age = proto->previousId - id;
+  if (age < 32)
+    proto->seen &= ~(1ul << age);
+}
+
+static void frameReceived(protocol_t *proto, const message_t *msg,
+                          bool ackRequested) {
+  switch (msg->command) {
+  case CMD_PROTO_ACK:
+  case CMD_PROTO_NACK:
+    if (msg->payloadSize >= 1)
+      txAcknowledged(msg->payload[0], msg->command == CMD_PROTO_ACK);
+    return;
+  }
+
+  if (isDuplicate(proto, msg->msgId)) {
+    /* Acknowledge resends too, the previous ACK might have been lost */
+    if (ackRequested)
+      txAnswer(CMD_PROTO_ACK, msg->msgId);
+    return;
+  }
+
+  /* Only acknowledged once taken; otherwise the sender tries again */
+  if (!proto->callback(msg)) {
+    forgetId(proto, msg->msgId);
+    return;
   }
+  if (ackRequested)
+    txAnswer(CMD_PROTO_ACK, msg->msgId);
+}
+
+static inline void frameDamaged(protocol_t *proto, uint8_t id,
+                                bool ackRequested) {
+  proto->errors++;
+  /* The ID might be damaged too, but then the sender times out anyway */
+  if (ackRequested)
+    txAnswer(CMD_PROTO_NACK, id);
 }
 
 static inline void messageReceived(protocol_t *proto) {
-  if (proto->buffer.msgId != proto->previousId) {
-    /* It's not a resend / duplicate */
-    proto->callback(&proto->buffer);
-    proto->previousId = proto->buffer.msgId;
+  if (proto->features & PROTO_FEATURE_CRC) {
+    proto->state = STATE_CRC;
+    return;
   }
   proto->state = STATE_SYNC_1;
+  frameReceived(proto, &proto->buffer, false);
+}
+
+/* CRC of the frame in proto->buffer */
+static inline uint8_t bufferCrc(const protocol_t *proto) {
+  const uint8_t header[4] = {
+      proto->ackRequested ? PROTO_SYNC_2_ACK : PROTO_SYNC_2,
+      proto->buffer.command,
+      proto->buffer.msgId,
+      proto->buffer.payloadSize,
+  };
+  return crc8(crc8(0, header, sizeof(header)), proto->buffer.payload,
+              proto->buffer.payloadSize);
 }
 
 void protoConsume(protocol_t *proto, uint8_t byte) {
   switch (proto->state) {
   case STATE_SYNC_1:
-    if (byte == 0x7A) {
+    if (byte == PROTO_SYNC_1) {
       proto->state = STATE_SYNC_2;
     } else {
       proto->errors++;
@@ -64,7 +317,9 @@ void protoConsume(protocol_t *proto, uint8_t byte) {
     return;
 
   case STATE_SYNC_2:
-    if (byte == 0x1D) {
+    proto->ackRequested = byte == PROTO_SYNC_2_ACK &&
+                          (proto->features & PROTO_FEATURE_CRC);
+    if (byte == PROTO_SYNC_2 || proto->ackRequested) {
       proto->state = STATE_CMD;
     } else {
       proto->state = STATE_SYNC_1;
@@ -107,6 +362,51 @@ void protoConsume(protocol_t *proto, uint8_t byte) {
       messageReceived(proto);
     }
     return;
+
+  case STATE_CRC:
+    proto->state = STATE_SYNC_1;
+    if (byte == bufferCrc(proto))
+      frameReceived(proto, &proto->buffer, proto->ackRequested);
+    else
+      frameDamaged(proto, proto->buffer.msgId, proto->ackRequested);
+    return;
+  }
+}
+
+/* Size of a complete frame with a valid header at the start of buf, or 0 if
+ * there isn't one. Its CRC is still to be checked. */
+static inline size_t wholeFrame(const protocol_t *proto, const uint8_t *buf,
+                                size_t len) {
+  const bool crc = proto->features & PROTO_FEATURE_CRC;
+  if (len < 5 || buf[0] != PROTO_SYNC_1 || buf[4] > MAX_PAYLOAD_SIZE)
+    return 0;
+  if (buf[1] != PROTO_SYNC_2 && !(crc && buf[1] == PROTO_SYNC_2_ACK))
+    return 0;
+
+  const size_t size = 5u + buf[4] + crc;
+  return len < size ? 0 : size;
+}
+
+void protoConsumeBuffer(protocol_t *proto, const uint8_t *buf, size_t len) {
+  const uint8_t *const end = buf + len;
+
+  while (buf < end) {
+    /* Complete frames are handled in place, with the same outcome as byte by
+     * byte. The header after the sync bytes has the layout of message_t. */
+    const size_t size =
+        proto->state == STATE_SYNC_1 ? wholeFrame(proto, buf, end - buf) : 0;
+    if (size > 0) {
+      const bool ackRequested = buf[1] == PROTO_SYNC_2_ACK;
+      if (!(proto->features & PROTO_FEATURE_CRC) ||
+          crc8(0, &buf[1], size - 2) == buf[size - 1])
+        frameReceived(proto, (const message_t *)(buf + 2), ackRequested);
+      else
+        frameDamaged(proto, buf[3], ackRequested);
+      buf += size;
+    } else {
+      /* Garbage, a damaged frame or one split between calls */
+      protoConsume(proto, *buf++);
+    }
   }
 }
 
@@ -9,6 +9,8 @@
 #ifndef PROTOCOL_INCLUDED
 #define PROTOCOL_INCLUDED
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #define PROTOCOL_SD SD1
 
@@ -26,6 +28,10 @@ enum {
 
   CMD_LED_NEXT_INTENSITY = 0x06,
   CMD_LED_NEXT_ANIMATION_SPEED = 0x07,
+  /* Profile crossfade length in frames (~14ms each), 0 disables it */
+  CMD_LED_SET_TRANSITION = 0x08,
+  /* Animation speed 0 - 255 */
+  CMD_LED_SET_ANIMATION_SPEED = 0x09,
 
   /* Masks */
   /* Override a key color, eg. capslock */
@@ -40,23 +46,42 @@ enum {
   CMD_LED_GET_STATUS = 0x20,
   CMD_LED_KEY_BLINK = 0x21,
   CMD_LED_KEY_DOWN = 0x22,
-  CMD_LED_KEY_UP = 0x23, /* TODO */
+  /* Same payload as KEY_DOWN */
+  CMD_LED_KEY_UP = 0x23,
   CMD_LED_IAP = 0x24,
+  /* Request a CMD_LED_PERF reply */
+  CMD_LED_GET_PERF = 0x25,
 
   /* Manual color control */
   CMD_LED_SET_MANUAL = 0x30,
   CMD_LED_COLOR_SET_KEY = 0x31,
   CMD_LED_COLOR_SET_ROW = 0x32,
   CMD_LED_COLOR_SET_MONO = 0x33,
+  /* Part of a whole frame: frame id, pixel format (see frameUpload.h),
+     fragment index, 60 bytes of pixels */
+  CMD_LED_FRAME_FRAGMENT = 0x34,
 
   /* LED -> Main */
   /* Payload with data to send over HID */
   CMD_LED_DEBUG = 0x40,
 
   /* Number of profiles, current profile, on/off state,
-     reactive flag, brightness, errors */
+     reactive flag, brightness, protocol errors, rejected commands */
   CMD_LED_STATUS = 0x41,
 
+  /* Last and worst frame render cost in CPU cycles (u32 LE each), number of
+     enabled layers, last and worst keypress to light latency in CPU cycles,
+     frames over the render budget (u16 LE), governor load level, receive
+     overruns (u16 LE), queued messages and their high-water mark, dropped
+     uploaded frames (u16 LE), executor stack never used in bytes (u16 LE),
+     messages refused with the command queue full (u16 LE), effect VM
+     programs stopped for a runtime fault */
+  CMD_LED_PERF = 0x42,
+
+  /* Reply to CMD_LED_LINK_HELLO: supported baud rates bitmask, supported
+     features, index of the chosen rate, negotiated features */
+  CMD_LED_LINK_CAPS = 0x43,
+
   /* Set sticky key, meaning the key will light up even when LEDs are turned off
    */
   CMD_LED_STICKY_SET_KEY = 0x50,
@@ -65,8 +90,80 @@ enum {
   CMD_LED_STICKY_UNSET_KEY = 0x53,
   CMD_LED_STICKY_UNSET_ROW = 0x54,
   CMD_LED_STICKY_UNSET_ALL = 0x55,
+
+  /* Effect VM: store program bytes at an offset, then validate & enable */
+  CMD_LED_VM_LOAD = 0x60,
+  CMD_LED_VM_COMMIT = 0x61,
+
+  /* Effect layers: layer, profile, speed (0 - 255), opacity, blend mode */
+  CMD_LED_LAYER_SET = 0x70,
+  /* Layer index, 0xFF clears all */
+  CMD_LED_LAYER_CLEAR = 0x71,
+  /* Scroll text in a layer: layer, speed, blend mode, foreground B G R,
+     background B G R, up to 48 characters */
+  CMD_LED_TEXT_SCROLL = 0x72,
+
+  /* Gradient palette used by palette profiles: palette id */
+  CMD_LED_SET_PALETTE = 0x80,
+  /* Custom palette stops, 4 bytes each: position, R, G, B */
+  CMD_LED_PALETTE_UPLOAD = 0x81,
+
+  /* Link handshake: bitmask of supported LINK_BAUD_RATES, feature bits. The
+     LED replies with CMD_LED_LINK_CAPS at the current rate, then both ends
+     switch to the chosen rate; the main MCU confirms it by repeating the
+     handshake at the new rate. */
+  CMD_LED_LINK_HELLO = 0x90,
+
+  /* Several messages in one frame. Each entry starts with the command (up to
+     0x7F) and the payload size, followed by the payload. An entry starting
+     with a byte with bit 7 set repeats the previous command, with the payload
+     size in the lower bits. */
+  CMD_LED_BATCH = 0x91,
+
+  /*
+   * Both ways, handled by the protocol itself
+   */
+  /* Acknowledge a message sent with PROTO_SYNC_2_ACK: msgId */
+  CMD_PROTO_ACK = 0xF0,
+  /* Such message arrived damaged: msgId */
+  CMD_PROTO_NACK = 0xF1,
+};
+
+/* Frame sync bytes. With PROTO_FEATURE_CRC, PROTO_SYNC_2_ACK in place of the
+ * second one requests an ACK. */
+#define PROTO_SYNC_1 0x7A
+#define PROTO_SYNC_2 0x1D
+#define PROTO_SYNC_2_ACK 0x1E
+
+/* Protocol features of the link handshake. They apply to frames sent after the
+ * CMD_LED_LINK_CAPS reply. */
+enum {
+  /* Frames end with a CRC-8 of everything after the first sync byte, and
+     messages sent with retries are acknowledged */
+  PROTO_FEATURE_CRC = 0x01,
+  /* CMD_LED_BATCH is supported */
+  PROTO_FEATURE_BATCH = 0x02,
 };
 
+/* Reliable messages which can wait for an ACK at once */
+#ifndef PROTO_WINDOW
+#define PROTO_WINDOW 4
+#endif
+
+/* Longest payload of a reliable message, longer ones are repeated blindly */
+#ifndef PROTO_WINDOW_PAYLOAD
+#define PROTO_WINDOW_PAYLOAD 24
+#endif
+
+/* Time to wait for an ACK before sending again */
+#define PROTO_ACK_TIMEOUT_MS 10
+
+/* Baud rates of the link handshake, bit n of the bitmask is the n-th rate.
+   115200 is the rate after reset and the fallback. */
+#define LINK_BAUD_RATES                                                        \
+  {115200, 230400, 460800, 921600, 1000000, 2000000, 3000000}
+#define LINK_BAUD_COUNT 7
+
 /* 1 ROW * 14 COLS * 4B (RGBX) = 56 + header prefix. */
 #define MAX_PAYLOAD_SIZE 64
 
@@ -83,9 +180,14 @@ enum protoState {
   STATE_PAYLOAD_SIZE,
   /* Reading payload until payloadPosition == payloadSize */
   STATE_PAYLOAD,
+  /* Waiting for the CRC, with PROTO_FEATURE_CRC */
+  STATE_CRC,
 };
 
-/* Buffer holding a single message */
+/* Buffer holding a single message. Received messages may also be views into
+ * the receive buffer: only payloadSize bytes of the payload are valid, and
+ * only during the callback. Callbacks must not read past them - the bytes
+ * after belong to the next frame or lie past the end of the buffer. */
 typedef struct {
   uint8_t command;
   uint8_t msgId;
@@ -95,8 +197,11 @@ typedef struct {
 
 /* Internal protocol state */
 typedef struct {
-  /* Callback to call upon receiving a valid message */
-  void (*callback)(const message_t *);
+  /* Callback to call upon receiving a valid message, which it must not read
+   * past payloadSize of. Returns false if the message can't be taken now;
+   * it's then not acknowledged, so a reliable message is sent again after
+   * the ACK timeout. */
+  bool (*callback)(const message_t *);
 
   /* Number of read payload bytes */
   uint8_t payloadPosition;
@@ -107,6 +212,13 @@ typedef struct {
   uint8_t previousId;
   uint8_t errors;
 
+  /* Negotiated PROTO_FEATURE_* */
+  uint8_t features;
+  /* Received frame requested an ACK */
+  bool ackRequested;
+  /* Bit n set - message previousId - n was received, 0 - none yet */
+  uint32_t seen;
+
   /* Currently received message */
   message_t buffer;
 } protocol_t;
@@ -115,16 +227,29 @@ typedef struct {
 extern protocol_t proto;
 
 /* Init state */
-extern void protoInit(protocol_t *proto, void (*callback)(const message_t *));
+extern void protoInit(protocol_t *proto, bool (*callback)(const message_t *));
 
 /* Consume one byte and push state forward - might call the callback */
 extern void protoConsume(protocol_t *proto, uint8_t byte);
 
+/* Enable negotiated features */
+extern void protoSetFeatures(protocol_t *proto, uint8_t features);
+
+/* Consume a received chunk - might call the callback for every message in
+ * it. Messages split between chunks are handled like in protoConsume. */
+extern void protoConsumeBuffer(protocol_t *proto, const uint8_t *buf,
+                               size_t len);
+
 /* Prolonged silence - reset state */
 extern void protoSilence(protocol_t *proto);
 
-/* Transmit message */
+/* Transmit message. With PROTO_FEATURE_CRC, a message with retries > 1 is
+ * sent once and again only until acknowledged. */
 extern void protoTx(uint8_t cmd, const unsigned char *buf, int payloadSize,
                     int retries);
 
+/* Send reliable messages again when their ACK times out. Returns true while
+ * some still wait for one. */
+extern bool protoTxPoll(void);
+
 #endif
@@ -5,7 +5,7 @@
  * Active profiles
  * Add profiles from source/profiles.h in the profile array
  */
-profile profiles[] = {
+const profile profiles[] = {
     /* {colorBleed, {0, 0, 0, 0}, NULL, NULL}, */
     {white, {0, 0, 0, 0}, NULL, NULL},
     {red, {0, 0, 0, 0}, NULL, NULL},
@@ -14,18 +14,38 @@ profile profiles[] = {
     {rainbowHorizontal, {0, 0, 0, 0}, NULL, NULL},
     {rainbowVertical, {0, 0, 0, 0}, NULL, NULL},
     {animatedRainbowVertical, {35, 28, 21, 14}, NULL, NULL},
-    {animatedRainbowFlow, {7, 5, 2, 1}, NULL, NULL},
-    {animatedRainbowWaterfall, {7, 5, 2, 1}, NULL, NULL},
-    {animatedBreathing, {5, 3, 2, 1}, NULL, NULL},
-    {animatedWave, {5, 3, 2, 1}, NULL, NULL},
-    {animatedSpectrum, {11, 6, 4, 1}, NULL, NULL},
+    {animatedRainbowFlow, {7, 5, 2, 1}, NULL, animatedRainbowFlowInit},
+    {animatedRainbowWaterfall, {7, 5, 2, 1}, NULL,
+     animatedRainbowWaterfallInit},
+    {animatedBreathing, {5, 3, 2, 1}, NULL, animatedBreathingInit},
+    {animatedWave, {5, 3, 2, 1}, NULL, animatedWaveInit},
+    {animatedSpectrum, {11, 6, 4, 1}, NULL, animatedSpectrumInit},
     {reactiveFade, {4, 3, 2, 1}, reactiveFadeKeypress, reactiveFadeInit},
     {reactivePulse, {4, 3, 2, 1}, reactivePulseKeypress, reactivePulseInit},
-    {reactiveTerm, {1, 2, 3, 4}, reactiveTermKeypress, reactiveTermInit}};
+    {reactiveTerm, {1, 2, 3, 4}, reactiveTermKeypress, reactiveTermInit},
+    {animatedPlasma, {4, 3, 2, 1}, NULL, paletteProfileInit},
+    {reactiveRipple, {4, 3, 2, 1}, reactiveRippleKeypress,
+     reactiveRippleInit},
+    {animatedSpiral, {4, 3, 2, 1}, NULL, NULL},
+    {animatedGradient, {4, 3, 2, 1}, NULL, paletteProfileInit},
+    {reactiveHold, {1, 1, 1, 1}, reactiveHoldKeypress, NULL},
+    {reactiveLife, {20, 14, 10, 7}, reactiveLifeKeypress, paletteProfileInit},
+    {reactiveWaves, {6, 4, 3, 2}, reactiveWavesKeypress, NULL},
+
+    /* Dark until the main MCU uploads a program, flashes an animation or sets
+     * the text; keep them last, see amountOfCycledProfiles */
+    {vmEffect, {4, 3, 2, 1}, NULL, vmEffectInit},
+    {animationPlayback, {4, 3, 2, 1}, NULL, animationPlaybackInit},
+    {textScroll, {14, 10, 7, 5}, NULL, textScrollInit}};
+
+/* Number of the profiles above which need uploaded content */
+#define UPLOAD_PROFILES 3
 
 /* Set your defaults here */
 uint8_t currentProfile = 0;
 const uint8_t amountOfProfiles = sizeof(profiles) / sizeof(profile);
+const uint8_t amountOfCycledProfiles =
+    sizeof(profiles) / sizeof(profile) - UPLOAD_PROFILES;
 volatile uint8_t currentSpeed = 0;
 uint8_t manualControl = 0;
 uint8_t backlightDisabled = 0;
@@ -23,9 +23,13 @@ typedef struct {
   //
   // Different 4 values can be specified to allow different speeds of the same
   // effect. For static effects, the array must contain {0, 0, 0, 0}.
+  // They are the speeds 0, 85, 170 and 255 of the 0-255 speed setting; speeds
+  // in between step at fractional rates.
   uint16_t animationSpeed[4];
   // In case the profile is reactive, it responds to each keypress.
   // This callback is called with the locations of the pressed keys.
+  // It runs from the PWM interrupt in between two columns, like
+  // `callback`, so it can touch their shared state but must be short.
   keypress_handler keypressCallback;
   // Some profiles might need additional setup when just enabled.
   // This callback defines such logic if needed.
@@ -33,9 +37,13 @@ typedef struct {
 } profile;
 
 /* You can select your defaults in settings.c */
-extern profile profiles[];
+extern const profile profiles[];
 extern uint8_t currentProfile;
 extern const uint8_t amountOfProfiles;
+/* Profiles cycled by CMD_LED_NEXT/PREV_PROFILE; the ones behind them only
+ * show uploaded content and are selected explicitly or run in a layer */
+extern const uint8_t amountOfCycledProfiles;
+/* 0 - 255, see profile.animationSpeed */
 extern volatile uint8_t currentSpeed;
 
 /* Whether ledColors should be updated in mainCallback in matrix.c */
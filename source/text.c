@@ -0,0 +1,77 @@
+/*
+    ===  text  ===
+    Bitmap blitter and the text shown by the scrolling text profile.
+*/
+#include "text.h"
+#include "matrix.h"
+#include "miniFastLED.h"
+#include "string.h"
+
+static struct {
+  char text[TEXT_MAX_LENGTH];
+  uint8_t length;
+  uint32_t fg, bg;
+} scroller = {"ANNE PRO 2", 10, 0xFFFFFF, 0x000000};
+
+static inline const uint8_t *glyph(char c) {
+  if (c >= 'a' && c <= 'z')
+    c -= 'a' - 'A';
+  if (c < FONT_FIRST || c > FONT_LAST)
+    c = '?';
+  return font3x5[c - FONT_FIRST];
+}
+
+void blitBitmap(led_t *ledColors, const uint8_t *bitmap, uint8_t width,
+                int16_t x, uint32_t fg, uint32_t bg) {
+  /* Clip to the board */
+  uint8_t first = 0;
+  if (x < 0) {
+    if (-x >= width)
+      return;
+    first = -x;
+  }
+  for (uint8_t i = first; i < width && x + i < NUM_COLUMN; i++) {
+    const uint8_t column = bitmap[i];
+    for (uint8_t row = 0; row < NUM_ROW; row++) {
+      ledColors[ROWCOL2IDX(row, x + i)].rgb =
+          (column & (1 << row)) ? fg : bg;
+    }
+  }
+}
+
+void blitText(led_t *ledColors, const char *text, uint8_t length, int16_t x,
+              uint32_t fg, uint32_t bg) {
+  static const uint8_t blank = 0;
+  for (uint8_t i = 0; i < length && x < NUM_COLUMN;
+       i++, x += FONT_ADVANCE) {
+    /* Skip glyphs left of the board */
+    if (x + FONT_ADVANCE <= 0)
+      continue;
+    blitBitmap(ledColors, glyph(text[i]), FONT_WIDTH, x, fg, bg);
+    blitBitmap(ledColors, &blank, 1, x + FONT_WIDTH, fg, bg);
+  }
+}
+
+bool textScrollSet(const char *text, uint8_t length, uint32_t fg,
+                   uint32_t bg) {
+  if (length > TEXT_MAX_LENGTH)
+    return false;
+
+  /* Rendered from the PWM interrupt */
+  chSysLock();
+  memcpy(scroller.text, text, length);
+  scroller.length = length;
+  scroller.fg = fg;
+  scroller.bg = bg;
+  chSysUnlock();
+  return true;
+}
+
+void textScrollRender(led_t *ledColors, int16_t x) {
+  const uint32_t bg = naiveDimRGB(scroller.bg);
+  setAllKeysColor(ledColors, bg);
+  blitText(ledColors, scroller.text, scroller.length, x,
+           naiveDimRGB(scroller.fg), bg);
+}
+
+int16_t textScrollWidth(void) { return scroller.length * FONT_ADVANCE; }
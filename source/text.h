@@ -0,0 +1,45 @@
+#ifndef TEXT_INCLUDED
+#define TEXT_INCLUDED
+
+#include "light_utils.h"
+
+/*
+ * 1bpp bitmaps and text for the 5-row key matrix.
+ *
+ * Bitmaps are stored column by column, one byte per column with bit n lit on
+ * row n - the whole height of the board fits a byte, so horizontal scrolling
+ * is just an offset into the columns. The font (source/font.c, generated by
+ * tools/genfont.py) uses the same format.
+ */
+
+#define FONT_FIRST 0x20
+#define FONT_LAST 0x5F
+#define FONT_WIDTH 3
+/* Glyph and the blank column after it */
+#define FONT_ADVANCE (FONT_WIDTH + 1)
+
+#define TEXT_MAX_LENGTH 48
+
+extern const uint8_t font3x5[FONT_LAST - FONT_FIRST + 1][FONT_WIDTH];
+
+/* Draw `width` bitmap columns with the left one at column `x` (which may be
+ * off the board). Lit pixels get `fg`, the others `bg`. */
+void blitBitmap(led_t *ledColors, const uint8_t *bitmap, uint8_t width,
+                int16_t x, uint32_t fg, uint32_t bg);
+
+/* Draw text starting at column `x`, glyphs FONT_ADVANCE columns apart */
+void blitText(led_t *ledColors, const char *text, uint8_t length, int16_t x,
+              uint32_t fg, uint32_t bg);
+
+/* Set the text shown by the textScroll profile. Returns false when it's too
+ * long. */
+bool textScrollSet(const char *text, uint8_t length, uint32_t fg,
+                   uint32_t bg);
+
+/* Fill the board with the background and draw the text at column `x` */
+void textScrollRender(led_t *ledColors, int16_t x);
+
+/* Width of the text in columns */
+int16_t textScrollWidth(void);
+
+#endif
@@ -0,0 +1,92 @@
+/*
+    ===  transition  ===
+    Crossfade from the previous profile to the current one.
+*/
+#include "transition.h"
+#include "blend.h"
+#include "governor.h"
+#include "layers.h"
+
+uint8_t transitionFrames = TRANSITION_DEFAULT_FRAMES;
+
+static struct {
+  bool active;
+  /* Profile's state and colors are intact, it can be switched back to */
+  bool resumable;
+  uint8_t frame;
+  /* transitionFrames as it was when the fade began */
+  uint8_t length;
+  /* Outgoing profile; rate is 0 if it's static or was frozen mid-way */
+  uint8_t profile;
+  uint32_t rate;
+  uint32_t phase;
+  profile_state *state;
+  led_t colors[KEY_COUNT];
+} transition;
+
+/* Eased 0..256 weight of the incoming profile */
+static inline uint16_t transitionAlpha(void) {
+  const uint8_t progress =
+      ((uint16_t)transition.frame * 255) / transition.length;
+  return blendAlpha(ease8InOutQuad(progress));
+}
+
+bool transitionBegin(uint8_t profile) {
+  /* The spare slot and frame still hold the profile that was left last */
+  const bool resume = transition.resumable && transition.profile == profile;
+  /* Switched again mid-way: fade from what is displayed right now */
+  const uint16_t alpha = transition.active ? transitionAlpha() : 256;
+
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    const uint32_t shown =
+        blendOpacity(transition.colors[i].rgb, ledColors[i].rgb, alpha);
+    if (resume)
+      ledColors[i] = transition.colors[i];
+    transition.colors[i].rgb = shown;
+  }
+
+  /* A blended frame can't be resumed from, so that profile is frozen */
+  transition.resumable = alpha == 256;
+  transition.profile = currentProfile;
+  transition.rate = transition.resumable ? animationRate : 0;
+  transition.phase = animationPhase;
+  transition.state = profileState;
+  transition.frame = 0;
+  transition.length = transitionFrames;
+  transition.active = transition.length > 0;
+  profileState = spareProfileState();
+  return resume;
+}
+
+const led_t *transitionRender(uint8_t frames) {
+  if (!transition.active)
+    return ledColors;
+
+  if (++transition.frame >= transition.length) {
+    transition.active = false;
+    return ledColors;
+  }
+
+  /* The outgoing profile is the first thing to go under load */
+  if (governorLevel < GOVERNOR_SPREAD_LEVEL &&
+      animationAdvance(&transition.phase, transition.rate, frames)) {
+    profile_state *const current = profileState;
+    profileState = transition.state;
+    profiles[transition.profile].callback(transition.colors);
+    profileState = current;
+  }
+
+  const uint16_t alpha = transitionAlpha();
+  for (uint8_t i = 0; i < KEY_COUNT; i++) {
+    ledComposite[i].rgb =
+        blendOpacity(transition.colors[i].rgb, ledColors[i].rgb, alpha);
+  }
+  return ledComposite;
+}
+
+uint32_t transitionKey(uint8_t key) {
+  if (!transition.active)
+    return ledColors[key].rgb;
+  return blendOpacity(transition.colors[key].rgb, ledColors[key].rgb,
+                      transitionAlpha());
+}
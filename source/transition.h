@@ -0,0 +1,41 @@
+#ifndef TRANSITION_INCLUDED
+#define TRANSITION_INCLUDED
+
+#include "profiles.h"
+
+/*
+ * Crossfade between profiles.
+ *
+ * On a profile switch the outgoing profile keeps running from the spare
+ * profile state slot into its own frame buffer, while the incoming one
+ * starts in ledColors as usual. For transitionFrames frames both are blended
+ * with an eased alpha ramp into ledComposite, under the effect layers. The
+ * extra cost is one render of the outgoing profile and one blend per frame.
+ *
+ * The spare slot and the outgoing frame are kept after the transition ends,
+ * so switching back to the profile that was left last resumes it where it
+ * stopped instead of initializing it again, at no extra RAM.
+ */
+
+/* ~340ms at 71Hz */
+#define TRANSITION_DEFAULT_FRAMES 24
+
+/* Transition length in frames, 0 switches instantly. Read once when a
+ * transition begins, so changing it only affects the next one. */
+extern uint8_t transitionFrames;
+
+/* Start fading out the current profile and move profileState to the spare
+ * slot for `profile`. Returns true if the slot and ledColors now hold its
+ * state and frame from when it was left, so it shouldn't be reset. Called
+ * with the system locked, just before currentProfile is switched. */
+bool transitionBegin(uint8_t profile);
+
+/* Called by the PWM interrupt on frame boundary after the current profile
+ * was rendered; the outgoing profile advances by `frames` (0 - paused).
+ * Returns the base frame for the effect layers. */
+const led_t *transitionRender(uint8_t frames);
+
+/* Base color of a single key, as transitionRender would blend it */
+uint32_t transitionKey(uint8_t key);
+
+#endif
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Writes the regression corpus of the protocol parser tests to corpus/.
+
+Each file is a received byte stream. Names starting with "crc-" are parsed
+with the CRC feature on, "plain-" ones without it. test_protocol replays
+every file byte by byte and split at every position, and uses them as seeds
+for its fuzzing; the outcomes have to match.
+
+The cases are the edges of the in-place fast path: frames ending exactly at
+a chunk boundary, damaged and oversized frames, and sync bytes inside
+payloads. Run it again after changing the frame format.
+"""
+
+import os
+import random
+
+SYNC_1 = 0x7A
+SYNC_2 = 0x1D
+SYNC_2_ACK = 0x1E
+MAX_PAYLOAD_SIZE = 64
+CMD_ACK = 0xF0
+CMD_NACK = 0xF1
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07 if crc & 0x80 else crc << 1) & 0xFF
+    return crc
+
+
+def frame(cmd, msg_id, payload=b"", crc=True, ack=False, size=None):
+    size = len(payload) if size is None else size
+    body = bytes([SYNC_2_ACK if ack else SYNC_2, cmd, msg_id, size])
+    body += bytes(payload)
+    out = bytes([SYNC_1]) + body
+    if crc:
+        out += bytes([crc8(body)])
+    return out
+
+
+def flip(data, pos, bit=0):
+    data = bytearray(data)
+    data[pos] ^= 1 << bit
+    return bytes(data)
+
+
+def random_stream(rng, crc, length):
+    out = b""
+    msg_id = rng.randrange(256)
+    while len(out) < length:
+        if rng.randrange(8) == 0:
+            out += bytes(rng.randrange(256) for _ in range(rng.randint(1, 4)))
+            continue
+        payload = bytes(rng.randrange(256)
+                        for _ in range(rng.randint(0, MAX_PAYLOAD_SIZE)))
+        data = frame(rng.randrange(256), msg_id, payload, crc,
+                     crc and rng.randrange(2) == 1)
+        msg_id = (msg_id + 1) & 0xFF
+        if rng.randrange(8) == 0:
+            data = flip(data, rng.randrange(1, len(data)), rng.randrange(8))
+        out += data
+    return out
+
+
+def cases():
+    full = bytes(range(MAX_PAYLOAD_SIZE))
+    syncs = bytes([SYNC_1, SYNC_2, SYNC_1, SYNC_2_ACK] * 4)
+
+    yield "plain-frames", (
+        frame(0x01, 1, crc=False) +
+        frame(0x31, 2, b"\x01\x02\x03", crc=False) +
+        frame(0x31, 3, full, crc=False) +
+        frame(0x31, 3, b"\x04", crc=False) +
+        frame(0x31, 4, syncs, crc=False))
+
+    yield "plain-garbage", (
+        b"\x00\xff" + bytes([SYNC_1, SYNC_1, SYNC_2]) +
+        frame(0x31, 1, b"\x01", crc=False, ack=True) +
+        frame(0x31, 2, b"\x01", crc=False, size=MAX_PAYLOAD_SIZE + 1) +
+        full + frame(0x31, 3, b"\x02", crc=False))
+
+    yield "crc-frames", (
+        frame(0x01, 10) +
+        frame(0x31, 11, b"\x01\x02", ack=True) +
+        frame(0x31, 13, full) +
+        frame(0x31, 12, b"\x03") +
+        frame(0x31, 11, b"\x01\x02", ack=True) +
+        frame(0x31, 14, syncs, ack=True) +
+        frame(CMD_ACK, 15, b"\x01") +
+        frame(CMD_NACK, 16, b"\x02"))
+
+    good = frame(0x31, 20, b"\x10\x20\x30\x40", ack=True)
+    yield "crc-damaged", (
+        flip(good, 1, 1) + flip(good, 2) + flip(good, 3) + flip(good, 4) +
+        flip(good, 6, 7) + flip(good, len(good) - 1) +
+        frame(0x31, 21, b"\x01") + good)
+
+    oversized = frame(0x31, 30, full, size=MAX_PAYLOAD_SIZE + 1)
+    yield "crc-oversized", (
+        oversized + b"\x00" * 4 + frame(0x31, 31, b"\x01") +
+        frame(0x31, 32, full[:8], size=0xFF) + frame(0x31, 33))
+
+    yield "crc-truncated", (
+        frame(0x31, 40, full)[:30] + frame(0x31, 41, b"\x01", ack=True) +
+        frame(0x31, 42, full)[:-1] + frame(0x31, 43) +
+        bytes([SYNC_1]) + frame(0x31, 44) +
+        bytes([SYNC_1, SYNC_2_ACK, 0x31]))
+
+    rng = random.Random(45)
+    yield "crc-random", random_stream(rng, True, 1500)
+    yield "plain-random", random_stream(rng, False, 1500)
+
+
+def main():
+    directory = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             "corpus")
+    os.makedirs(directory, exist_ok=True)
+    for name, data in cases():
+        with open(os.path.join(directory, name), "wb") as out:
+            out.write(data)
+
+
+if __name__ == "__main__":
+    main()
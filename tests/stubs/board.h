@@ -0,0 +1,3 @@
+#ifndef BOARD_H
+#define BOARD_H
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Just enough of ChibiOS for the protocol on the host: a single thread, so
+ * locks do nothing, and a clock the tests move by hand.
+ */
+#ifndef CH_H
+#define CH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef uint32_t eventmask_t;
+typedef uint32_t eventflags_t;
+
+typedef struct {
+  int unused;
+} mutex_t;
+
+typedef struct {
+  int unused;
+} event_source_t;
+
+typedef struct {
+  eventmask_t events;
+  eventflags_t wanted;
+} event_listener_t;
+
+#define MUTEX_DECL(name) mutex_t name = {0}
+#define TIME_MS2I(ms) ((sysinterval_t)(ms))
+#define TIME_US2I(us) ((sysinterval_t)((us) / 1000))
+#define EVENT_MASK(n) ((eventmask_t)1 << (n))
+#define chDbgCheck(c) ((void)(c))
+
+static inline void chSysLock(void) {}
+static inline void chSysUnlock(void) {}
+static inline void chMtxLock(mutex_t *m) { (void)m; }
+static inline void chMtxUnlock(mutex_t *m) { (void)m; }
+
+/* Milliseconds, advanced by the tests */
+extern systime_t testClock;
+
+/* Flags the next chEvtGetAndClearFlags returns, set by the tests */
+extern eventflags_t testFlags;
+
+static inline void chThdSleepMilliseconds(uint32_t ms) { testClock += ms; }
+
+static inline void chEvtRegisterMaskWithFlags(event_source_t *source,
+                                              event_listener_t *listener,
+                                              eventmask_t events,
+                                              eventflags_t wanted) {
+  (void)source;
+  listener->events = events;
+  listener->wanted = wanted;
+}
+
+static inline eventflags_t chEvtGetAndClearFlags(event_listener_t *listener) {
+  const eventflags_t flags = testFlags & listener->wanted;
+  testFlags = 0;
+  return flags;
+}
+
+static inline systime_t chVTGetSystemTimeX(void) { return testClock; }
+
+static inline sysinterval_t chVTTimeElapsedSinceX(systime_t start) {
+  return testClock - start;
+}
+
+#endif
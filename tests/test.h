@@ -0,0 +1,27 @@
+/*
+ * Minimal host test harness: CHECK records a failure and carries on, so one
+ * run reports every broken case.
+ */
+#ifndef TEST_INCLUDED
+#define TEST_INCLUDED
+
+#include <stdio.h>
+
+static int testFailures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);          \
+      testFailures++;                                                          \
+    }                                                                          \
+  } while (0)
+
+#define RUN(test)                                                              \
+  do {                                                                         \
+    const int before = testFailures;                                           \
+    test();                                                                    \
+    printf("%-24s %s\n", #test, testFailures == before ? "ok" : "FAILED");     \
+  } while (0)
+
+#endif
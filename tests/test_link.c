@@ -0,0 +1,179 @@
+/*
+ * Host tests of the link negotiation, with the test standing in for the
+ * main MCU: handshake, rate choice, probation and error fallback.
+ */
+#include "../source/link.c"
+#include "../source/protocol.c"
+#include "test.h"
+
+systime_t testClock;
+eventflags_t testFlags;
+SerialDriver SD1;
+
+static const uint32_t rates[LINK_BAUD_COUNT] = LINK_BAUD_RATES;
+
+static bool ignore(const message_t *msg) {
+  (void)msg;
+  return true;
+}
+
+/* Power on */
+static void reset(void) {
+  testClock = 0;
+  testFlags = 0;
+  SD1.size = 0;
+  protoInit(&proto, ignore);
+  linkConfig.speed = rates[0];
+  linkBaud = 0;
+  linkFeatures = 0;
+  linkOverruns = 0;
+  health.probation = false;
+  linkInit();
+  restartWindow();
+}
+
+static void hello(uint8_t mask, uint8_t features) {
+  message_t msg = {.command = CMD_LED_LINK_HELLO, .payloadSize = 2};
+  msg.payload[0] = mask;
+  msg.payload[1] = features;
+  SD1.size = 0;
+  linkHello(&msg);
+}
+
+/* The CMD_LED_LINK_CAPS reply, NULL if none was sent */
+static const uint8_t *caps(void) {
+  if (SD1.size < 9 || SD1.data[2] != CMD_LED_LINK_CAPS || SD1.data[4] != 4)
+    return NULL;
+  return &SD1.data[5];
+}
+
+static void testHandshake(void) {
+  reset();
+  CHECK(SD1.speed == 115200);
+
+  hello(0x7F, PROTO_FEATURE_CRC | PROTO_FEATURE_BATCH);
+  const uint8_t *reply = caps();
+  CHECK(reply != NULL);
+  /* Sent before switching */
+  CHECK(SD1.writeSpeed == 115200);
+  if (reply != NULL) {
+    CHECK(reply[0] == LINK_BAUD_MASK);
+    CHECK(reply[1] == LINK_FEATURES);
+    CHECK(reply[2] == LINK_BAUD_COUNT - 1);
+    CHECK(reply[3] == (PROTO_FEATURE_CRC | PROTO_FEATURE_BATCH));
+  }
+  CHECK(SD1.speed == rates[LINK_BAUD_COUNT - 1]);
+  CHECK(proto.features == (PROTO_FEATURE_CRC | PROTO_FEATURE_BATCH));
+  CHECK(health.probation);
+  CHECK(linkIdle >= TIME_MS2I(1));
+
+  /* Confirmed at the new rate */
+  hello(0x7F, PROTO_FEATURE_CRC | PROTO_FEATURE_BATCH);
+  CHECK(caps() != NULL);
+  CHECK(SD1.writeSpeed == rates[LINK_BAUD_COUNT - 1]);
+  CHECK(!health.probation);
+
+  /* A healthy link stays up */
+  for (int i = 0; i < 50; i++) {
+    testClock += 100;
+    linkPoll();
+  }
+  CHECK(SD1.speed == rates[LINK_BAUD_COUNT - 1]);
+}
+
+static void testHighestCommonRate(void) {
+  reset();
+  /* 115200, 460800 and 2000000 on the other side */
+  hello(0x01 | 0x04 | 0x20, 0);
+  CHECK(linkBaud == 5);
+  CHECK(SD1.speed == 2000000);
+  CHECK(proto.features == 0);
+
+  /* Only unknown features offered */
+  reset();
+  hello(0x01, 0x80);
+  CHECK(caps() != NULL && caps()[3] == 0);
+  CHECK(linkBaud == 0 && SD1.speed == 115200);
+  CHECK(!health.probation);
+
+  /* Too short */
+  reset();
+  message_t msg = {.command = CMD_LED_LINK_HELLO, .payloadSize = 1};
+  linkHello(&msg);
+  CHECK(proto.errors == 1);
+  CHECK(caps() == NULL);
+}
+
+static void testProbationFallback(void) {
+  reset();
+  hello(0x7F, PROTO_FEATURE_CRC);
+  testClock += LINK_PROBATION_MS - 1;
+  linkPoll();
+  CHECK(linkBaud == LINK_BAUD_COUNT - 1);
+
+  /* The main MCU never repeated the handshake */
+  testClock += 1;
+  linkPoll();
+  CHECK(linkBaud == 0 && SD1.speed == 115200);
+  CHECK(linkFeatures == 0 && proto.features == 0);
+  CHECK(!health.probation);
+}
+
+static void testErrorFallback(void) {
+  /* Errors spread over more than a second are tolerated */
+  reset();
+  hello(0x7F, PROTO_FEATURE_CRC);
+  hello(0x7F, PROTO_FEATURE_CRC);
+  for (int i = 0; i < 3 * LINK_ERROR_LIMIT; i++) {
+    testClock += 1000 / (LINK_ERROR_LIMIT - 2);
+    testFlags = SD_FRAMING_ERROR;
+    linkPoll();
+  }
+  CHECK(linkBaud == LINK_BAUD_COUNT - 1);
+
+  /* A burst of framing errors falls back */
+  for (int i = 0; i < LINK_ERROR_LIMIT; i++) {
+    testFlags = SD_FRAMING_ERROR;
+    linkPoll();
+  }
+  CHECK(linkBaud == 0 && SD1.speed == 115200 && proto.features == 0);
+
+  /* Protocol errors count too */
+  reset();
+  hello(0x7F, PROTO_FEATURE_CRC);
+  hello(0x7F, PROTO_FEATURE_CRC);
+  for (int i = 0; i < LINK_ERROR_LIMIT; i++) {
+    protoConsume(&proto, 0x00);
+  }
+  linkPoll();
+  CHECK(linkBaud == 0);
+
+  /* At the base rate there is nothing to fall back from */
+  reset();
+  for (int i = 0; i < LINK_ERROR_LIMIT; i++) {
+    testFlags = SD_FRAMING_ERROR;
+    linkPoll();
+  }
+  CHECK(linkBaud == 0 && SD1.speed == 115200);
+}
+
+static void testOverruns(void) {
+  reset();
+  testFlags = SD_OVERRUN_ERROR;
+  linkPoll();
+  testFlags = SD_QUEUE_FULL_ERROR;
+  linkPoll();
+  testFlags = CHN_INPUT_AVAILABLE;
+  linkPoll();
+  CHECK(linkOverruns == 2);
+}
+
+int main(void) {
+  RUN(testHandshake);
+  RUN(testHighestCommonRate);
+  RUN(testProbationFallback);
+  RUN(testErrorFallback);
+  RUN(testOverruns);
+
+  return testFailures ? 1 : 0;
+}
@@ -0,0 +1,603 @@
+/*
+ * Host tests of the serial protocol: CRC, duplicate detection, framing of
+ * whole and split bursts, and the ACK window.
+ *
+ * The protocol is included as a whole so its static helpers can be tested.
+ * The random streams use a fixed seed unless one is given as the argument;
+ * the streams in corpus/ are written by mkcorpus.py.
+ */
+#include "../source/protocol.c"
+#include "test.h"
+#include <dirent.h>
+#include <stdlib.h>
+#include <time.h>
+
+systime_t testClock;
+SerialDriver SD1;
+
+/* Messages passed to the callback, in order */
+#define LOG_SIZE 512
+static message_t received[LOG_SIZE];
+static size_t receivedCount;
+
+/* Messages to refuse, like a full command queue would */
+static int refuse;
+
+static bool logMessage(const message_t *msg) {
+  if (refuse > 0) {
+    refuse--;
+    return false;
+  }
+  if (receivedCount < LOG_SIZE) {
+    message_t *out = &received[receivedCount];
+    out->command = msg->command;
+    out->msgId = msg->msgId;
+    out->payloadSize = msg->payloadSize;
+    memcpy(out->payload, msg->payload, msg->payloadSize);
+  }
+  receivedCount++;
+  return true;
+}
+
+static void reset(uint8_t features) {
+  protoInit(&proto, logMessage);
+  protoSetFeatures(&proto, features);
+  receivedCount = 0;
+  refuse = 0;
+  SD1.size = 0;
+  testClock = 0;
+}
+
+/* Encode a frame into out, returns its size */
+static size_t encode(uint8_t *out, bool crc, bool ack, uint8_t cmd, uint8_t id,
+                     const uint8_t *payload, uint8_t size) {
+  out[0] = PROTO_SYNC_1;
+  out[1] = ack ? PROTO_SYNC_2_ACK : PROTO_SYNC_2;
+  out[2] = cmd;
+  out[3] = id;
+  out[4] = size;
+  if (size)
+    memcpy(&out[5], payload, size);
+  if (!crc)
+    return 5u + size;
+  out[5 + size] = crc8(0, &out[1], 4u + size);
+  return 6u + size;
+}
+
+/* Same, straight into the receiver */
+static void receive(bool ack, uint8_t cmd, uint8_t id, const uint8_t *payload,
+                    uint8_t size) {
+  uint8_t buf[80];
+  const bool crc = proto.features & PROTO_FEATURE_CRC;
+  const size_t len = encode(buf, crc, ack, cmd, id, payload, size);
+  protoConsumeBuffer(&proto, buf, len);
+}
+
+/* Frames written to the serial driver since the last reset */
+typedef struct {
+  uint8_t sync;
+  uint8_t command;
+  uint8_t msgId;
+  uint8_t payload0;
+} sent_t;
+
+static size_t sentFrames(sent_t *out, size_t max) {
+  size_t count = 0;
+  size_t pos = 0;
+  const bool crc = proto.features & PROTO_FEATURE_CRC;
+  while (pos + 5 <= SD1.size && count < max) {
+    const uint8_t size = SD1.data[pos + 4];
+    out[count].sync = SD1.data[pos + 1];
+    out[count].command = SD1.data[pos + 2];
+    out[count].msgId = SD1.data[pos + 3];
+    out[count].payload0 = size ? SD1.data[pos + 5] : 0;
+    count++;
+    pos += 5u + size + crc;
+  }
+  return count;
+}
+
+/* xorshift32 */
+#define DEFAULT_SEED 2463534242u
+static uint32_t rngState;
+
+static uint32_t rng(void) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static void testCrcVectors(void) {
+  /* CRC-8/SMBUS check value */
+  const uint8_t check[] = "123456789";
+  CHECK(crc8(0, check, 9) == 0xF4);
+  CHECK(crc8(0, check, 0) == 0x00);
+  CHECK(crc8Table[1] == 0x07);
+
+  /* Continuing a CRC equals computing it at once */
+  CHECK(crc8(crc8(0, check, 4), check + 4, 5) == 0xF4);
+
+  /* Every single bit flip of a frame is caught */
+  uint8_t frame[80];
+  const uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  const size_t size = encode(frame, true, false, 0x31, 7, payload, 8);
+  const uint8_t good = crc8(0, &frame[1], size - 2);
+  for (size_t bit = 8; bit < (size - 1) * 8; bit++) {
+    frame[bit / 8] ^= 1u << (bit % 8);
+    CHECK(crc8(0, &frame[1], size - 2) != good);
+    frame[bit / 8] ^= 1u << (bit % 8);
+  }
+}
+
+static void testDuplicatesWithoutCrc(void) {
+  reset(0);
+  receive(false, 0x01, 5, NULL, 0);
+  receive(false, 0x01, 5, NULL, 0);
+  CHECK(receivedCount == 1);
+
+  /* Only consecutive resends are dropped */
+  receive(false, 0x01, 6, NULL, 0);
+  receive(false, 0x01, 5, NULL, 0);
+  CHECK(receivedCount == 3);
+}
+
+static void testDuplicates(void) {
+  reset(PROTO_FEATURE_CRC);
+  receive(false, 0x01, 10, NULL, 0);
+  receive(false, 0x01, 10, NULL, 0);
+  CHECK(receivedCount == 1);
+
+  /* Out of order: an older id not seen yet is new, then a duplicate */
+  receive(false, 0x01, 13, NULL, 0);
+  receive(false, 0x01, 12, NULL, 0);
+  receive(false, 0x01, 11, NULL, 0);
+  CHECK(receivedCount == 4);
+  receive(false, 0x01, 12, NULL, 0);
+  receive(false, 0x01, 10, NULL, 0);
+  receive(false, 0x01, 13, NULL, 0);
+  CHECK(receivedCount == 4);
+
+  /* The ids wrap around */
+  reset(PROTO_FEATURE_CRC);
+  for (unsigned id = 250; id < 262; id++) {
+    receive(false, 0x01, (uint8_t)id, NULL, 0);
+  }
+  CHECK(receivedCount == 12);
+  receive(false, 0x01, 254, NULL, 0);
+  receive(false, 0x01, 3, NULL, 0);
+  CHECK(receivedCount == 12);
+
+  /* Bit 31 is the oldest remembered id */
+  reset(PROTO_FEATURE_CRC);
+  for (unsigned id = 0; id < 32; id++) {
+    receive(false, 0x01, (uint8_t)id, NULL, 0);
+  }
+  receive(false, 0x01, 0, NULL, 0);
+  CHECK(receivedCount == 32);
+
+  /* 32 ids back it's too old to tell; the sender likely restarted */
+  receive(false, 0x01, 32, NULL, 0);
+  receive(false, 0x01, 0, NULL, 0);
+  CHECK(receivedCount == 34);
+  /* ...and it starts over from there */
+  receive(false, 0x01, 0, NULL, 0);
+  CHECK(receivedCount == 34);
+
+  /* A jump of more than 32 ids forgets the ones before */
+  reset(PROTO_FEATURE_CRC);
+  receive(false, 0x01, 1, NULL, 0);
+  receive(false, 0x01, 40, NULL, 0);
+  receive(false, 0x01, 41, NULL, 0);
+  CHECK(receivedCount == 3);
+  receive(false, 0x01, 40, NULL, 0);
+  CHECK(receivedCount == 3);
+}
+
+static void testMalformed(void) {
+  uint8_t buf[160];
+  uint8_t payload[MAX_PAYLOAD_SIZE + 1] = {0};
+
+  /* Too long a payload is an error and isn't delivered */
+  reset(PROTO_FEATURE_CRC);
+  size_t size = encode(buf, true, false, 0x31, 1, payload, MAX_PAYLOAD_SIZE);
+  buf[4] = MAX_PAYLOAD_SIZE + 1;
+  buf[size - 1] = crc8(0, &buf[1], size - 2);
+  protoConsumeBuffer(&proto, buf, size);
+  CHECK(receivedCount == 0);
+  CHECK(proto.errors > 0);
+  /* Silence ends the broken frame, the next one is received */
+  protoSilence(&proto);
+  size = encode(buf, true, false, 0x31, 2, payload, 4);
+  protoConsumeBuffer(&proto, buf, size);
+  CHECK(receivedCount == 1 && received[0].msgId == 2);
+
+  /* A frame cut short by silence is dropped */
+  reset(PROTO_FEATURE_CRC);
+  size = encode(buf, true, false, 0x31, 3, payload, 20);
+  protoConsumeBuffer(&proto, buf, size - 5);
+  protoSilence(&proto);
+  CHECK(receivedCount == 0);
+  CHECK(proto.errors == 1);
+  CHECK(proto.state == STATE_SYNC_1);
+
+  /* A damaged frame asking for an ACK gets a NACK */
+  reset(PROTO_FEATURE_CRC);
+  size = encode(buf, true, true, 0x31, 4, payload, 4);
+  buf[6] ^= 0x10;
+  protoConsumeBuffer(&proto, buf, size);
+  sent_t sent[4];
+  CHECK(receivedCount == 0);
+  CHECK(sentFrames(sent, 4) == 1);
+  CHECK(sent[0].command == CMD_PROTO_NACK && sent[0].payload0 == 4);
+
+  /* Without the CRC feature the ACK sync byte is garbage */
+  reset(0);
+  size = encode(buf, false, true, 0x31, 5, payload, 4);
+  protoConsumeBuffer(&proto, buf, size);
+  CHECK(receivedCount == 0);
+  CHECK(proto.errors > 0);
+}
+
+/* Build a stream of frames with some garbage and damaged frames between */
+static size_t randomStream(uint8_t *out, size_t max, bool crc) {
+  size_t len = 0;
+  uint8_t id = rng();
+  while (len + 80 < max) {
+    const uint32_t kind = rng() % 8;
+    if (kind == 0) {
+      /* Garbage */
+      const uint8_t count = 1 + rng() % 4;
+      for (uint8_t i = 0; i < count; i++) {
+        out[len++] = rng();
+      }
+      continue;
+    }
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    const uint8_t size = rng() % (MAX_PAYLOAD_SIZE + 1);
+    for (uint8_t i = 0; i < size; i++) {
+      payload[i] = rng();
+    }
+    const size_t frame =
+        encode(&out[len], crc, crc && rng() % 2, rng(), id++, payload, size);
+    if (kind == 1) {
+      /* Damaged */
+      out[len + 1 + rng() % (frame - 1)] ^= 1u << (rng() % 8);
+    }
+    len += frame;
+  }
+  return len;
+}
+
+typedef struct {
+  message_t messages[LOG_SIZE];
+  size_t count;
+  uint8_t errors;
+  size_t sent;
+} outcome_t;
+
+static void saveOutcome(outcome_t *out) {
+  memcpy(out->messages, received, sizeof(received));
+  out->count = receivedCount;
+  out->errors = proto.errors;
+  out->sent = SD1.size;
+}
+
+static bool sameOutcome(const outcome_t *a, const outcome_t *b) {
+  if (a->count != b->count || a->errors != b->errors || a->sent != b->sent)
+    return false;
+  for (size_t i = 0; i < a->count && i < LOG_SIZE; i++) {
+    const message_t *x = &a->messages[i], *y = &b->messages[i];
+    if (x->command != y->command || x->msgId != y->msgId ||
+        x->payloadSize != y->payloadSize ||
+        memcmp(x->payload, y->payload, x->payloadSize) != 0)
+      return false;
+  }
+  return true;
+}
+
+/* Corpus streams, with the features they are parsed with */
+#define CORPUS_MAX 16
+#define CORPUS_STREAM_MAX 2000
+
+typedef struct {
+  char name[256];
+  uint8_t features;
+  uint8_t data[CORPUS_STREAM_MAX];
+  size_t len;
+} corpus_t;
+
+static corpus_t corpus[CORPUS_MAX];
+static size_t corpusCount;
+
+static void loadCorpus(const char *path) {
+  DIR *dir = opendir(path);
+  CHECK(dir != NULL);
+  if (dir == NULL)
+    return;
+  const struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL && corpusCount < CORPUS_MAX) {
+    uint8_t features;
+    if (strncmp(entry->d_name, "crc-", 4) == 0)
+      features = PROTO_FEATURE_CRC;
+    else if (strncmp(entry->d_name, "plain-", 6) == 0)
+      features = 0;
+    else
+      continue;
+
+    char file[300];
+    snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+    FILE *in = fopen(file, "rb");
+    CHECK(in != NULL);
+    if (in == NULL)
+      continue;
+    corpus_t *c = &corpus[corpusCount++];
+    snprintf(c->name, sizeof(c->name), "%s", entry->d_name);
+    c->features = features;
+    c->len = fread(c->data, 1, sizeof(c->data), in);
+    fclose(in);
+  }
+  closedir(dir);
+}
+
+/* Parse a stream byte by byte, or in chunks of at most `chunk` bytes; 0 is
+ * random chunks */
+static void parse(outcome_t *out, uint8_t features, const uint8_t *stream,
+                  size_t len, size_t chunk) {
+  reset(features);
+  for (size_t pos = 0; pos < len;) {
+    size_t size = chunk ? chunk : 1 + rng() % 100;
+    if (size > len - pos)
+      size = len - pos;
+    if (chunk == 1)
+      protoConsume(&proto, stream[pos]);
+    else
+      protoConsumeBuffer(&proto, stream + pos, size);
+    pos += size;
+  }
+  saveOutcome(out);
+}
+
+/* The checked-in streams parse the same split at any point and in chunks of
+ * any size */
+static void testCorpus(void) {
+  static outcome_t bytewise, split;
+
+  CHECK(corpusCount > 0);
+  for (size_t i = 0; i < corpusCount; i++) {
+    const corpus_t *c = &corpus[i];
+    parse(&bytewise, c->features, c->data, c->len, 1);
+
+    for (size_t at = 0; at <= c->len; at++) {
+      reset(c->features);
+      protoConsumeBuffer(&proto, c->data, at);
+      protoConsumeBuffer(&proto, c->data + at, c->len - at);
+      saveOutcome(&split);
+      if (!sameOutcome(&bytewise, &split)) {
+        printf("%s: split at %zu differs\n", c->name, at);
+        testFailures++;
+        break;
+      }
+    }
+    for (size_t chunk = 2; chunk <= 2u * MAX_PAYLOAD_SIZE; chunk++) {
+      parse(&split, c->features, c->data, c->len, chunk);
+      if (!sameOutcome(&bytewise, &split)) {
+        printf("%s: chunks of %zu differ\n", c->name, chunk);
+        testFailures++;
+        break;
+      }
+    }
+  }
+}
+
+/* A burst split at any point parses the same as byte by byte */
+static void testFragmented(void) {
+  static uint8_t stream[600];
+  static outcome_t bytewise, split;
+
+  for (int features = 0; features <= PROTO_FEATURE_CRC; features++) {
+    const bool crc = features & PROTO_FEATURE_CRC;
+    const size_t len = randomStream(stream, sizeof(stream), crc);
+
+    reset(features);
+    for (size_t i = 0; i < len; i++) {
+      protoConsume(&proto, stream[i]);
+    }
+    saveOutcome(&bytewise);
+    CHECK(bytewise.count > 0);
+
+    for (size_t at = 0; at <= len; at++) {
+      reset(features);
+      protoConsumeBuffer(&proto, stream, at);
+      protoConsumeBuffer(&proto, stream + at, len - at);
+      saveOutcome(&split);
+      CHECK(sameOutcome(&bytewise, &split));
+    }
+  }
+}
+
+/* Random streams and mutated corpus streams in random chunks */
+static void testFuzz(void) {
+  static uint8_t stream[CORPUS_STREAM_MAX];
+  static outcome_t bytewise, chunked;
+
+  for (int run = 0; run < 400; run++) {
+    uint8_t features = run % 2 ? PROTO_FEATURE_CRC : 0;
+    size_t len;
+    if (run % 4 < 2 || corpusCount == 0) {
+      len = randomStream(stream, sizeof(stream), features & PROTO_FEATURE_CRC);
+    } else {
+      const corpus_t *c = &corpus[rng() % corpusCount];
+      features = c->features;
+      len = c->len;
+      memcpy(stream, c->data, len);
+      for (int flips = 1 + rng() % 8; flips > 0 && len > 0; flips--) {
+        stream[rng() % len] ^= 1u << (rng() % 8);
+      }
+    }
+
+    parse(&bytewise, features, stream, len, 1);
+    parse(&chunked, features, stream, len, 0);
+    CHECK(sameOutcome(&bytewise, &chunked));
+  }
+}
+
+static void testAckRequested(void) {
+  reset(PROTO_FEATURE_CRC);
+  const uint8_t payload[2] = {1, 2};
+  receive(true, 0x31, 9, payload, 2);
+  /* A resend is acknowledged again, but not delivered again */
+  receive(true, 0x31, 9, payload, 2);
+
+  sent_t sent[4];
+  CHECK(receivedCount == 1);
+  CHECK(sentFrames(sent, 4) == 2);
+  CHECK(sent[0].command == CMD_PROTO_ACK && sent[0].payload0 == 9);
+  CHECK(sent[1].command == CMD_PROTO_ACK && sent[1].payload0 == 9);
+}
+
+/* A message the callback can't take isn't acknowledged, and its resend is
+ * taken */
+static void testRefused(void) {
+  const uint8_t payload[2] = {1, 2};
+  sent_t sent[4];
+
+  reset(PROTO_FEATURE_CRC);
+  receive(true, 0x31, 20, payload, 2);
+  refuse = 1;
+  receive(true, 0x31, 21, payload, 2);
+  receive(true, 0x31, 22, payload, 2);
+  CHECK(receivedCount == 2);
+  CHECK(sentFrames(sent, 4) == 2);
+  CHECK(sent[0].payload0 == 20 && sent[1].payload0 == 22);
+
+  receive(true, 0x31, 21, payload, 2);
+  CHECK(receivedCount == 3 && received[2].msgId == 21);
+  CHECK(sentFrames(sent, 4) == 3);
+  CHECK(sent[2].command == CMD_PROTO_ACK && sent[2].payload0 == 21);
+  /* Other ids are still remembered */
+  receive(true, 0x31, 22, payload, 2);
+  CHECK(receivedCount == 3);
+
+  /* Without the CRC, the next copy of a message is taken */
+  reset(0);
+  refuse = 1;
+  receive(false, 0x31, 7, payload, 2);
+  receive(false, 0x31, 7, payload, 2);
+  CHECK(receivedCount == 1);
+}
+
+static void testWindow(void) {
+  const uint8_t payload[4] = {1, 2, 3, 4};
+  sent_t sent[16];
+
+  /* Sent once, then again after the timeout until the retries run out */
+  reset(PROTO_FEATURE_CRC);
+  protoTx(0x42, payload, sizeof(payload), 2);
+  CHECK(sentFrames(sent, 16) == 1);
+  CHECK(sent[0].sync == PROTO_SYNC_2_ACK);
+  const uint8_t id = sent[0].msgId;
+  testClock += PROTO_ACK_TIMEOUT_MS - 1;
+  CHECK(protoTxPoll());
+  CHECK(sentFrames(sent, 16) == 1);
+  testClock += 1;
+  CHECK(protoTxPoll());
+  CHECK(sentFrames(sent, 16) == 2 && sent[1].msgId == id);
+  testClock += PROTO_ACK_TIMEOUT_MS;
+  CHECK(!protoTxPoll());
+  CHECK(proto.errors == 1);
+
+  /* A NACK sends it again right away, an ACK frees the slot */
+  reset(PROTO_FEATURE_CRC);
+  protoTx(0x42, payload, sizeof(payload), 3);
+  sentFrames(sent, 16);
+  const uint8_t nacked = sent[0].msgId;
+  receive(false, CMD_PROTO_NACK, 200, &nacked, 1);
+  CHECK(sentFrames(sent, 16) == 2 && sent[1].msgId == nacked);
+  receive(false, CMD_PROTO_ACK, 201, &nacked, 1);
+  CHECK(!protoTxPoll());
+  CHECK(proto.errors == 0);
+  /* Answers aren't passed on */
+  CHECK(receivedCount == 0);
+
+  /* With the window full, messages are repeated blindly */
+  reset(PROTO_FEATURE_CRC);
+  for (int i = 0; i < PROTO_WINDOW; i++) {
+    protoTx(0x42, payload, sizeof(payload), 3);
+  }
+  CHECK(sentFrames(sent, 16) == PROTO_WINDOW);
+  protoTx(0x43, payload, sizeof(payload), 3);
+  CHECK(sentFrames(sent, 16) == PROTO_WINDOW + 3);
+  CHECK(sent[PROTO_WINDOW].sync == PROTO_SYNC_2);
+
+  /* So are messages too long for a window slot */
+  reset(PROTO_FEATURE_CRC);
+  for (uint8_t i = 0; i < PROTO_WINDOW; i++) {
+    window[i].used = false;
+  }
+  uint8_t longPayload[PROTO_WINDOW_PAYLOAD + 1] = {0};
+  protoTx(0x44, longPayload, sizeof(longPayload), 2);
+  CHECK(sentFrames(sent, 16) == 2);
+  CHECK(!protoTxPoll());
+
+  /* Turning the CRC off drops the waiting messages */
+  reset(PROTO_FEATURE_CRC);
+  protoTx(0x42, payload, sizeof(payload), 3);
+  protoSetFeatures(&proto, 0);
+  CHECK(!protoTxPoll());
+}
+
+/* Not a pass/fail test: parsing speed of whole bursts vs byte by byte, in
+ * 80-byte chunks like the serial driver's buffer */
+static void benchmark(uint8_t features) {
+  static uint8_t stream[64 * 1024];
+  const size_t len =
+      randomStream(stream, sizeof(stream), features & PROTO_FEATURE_CRC);
+  const int rounds = 50;
+
+  clock_t start = clock();
+  for (int r = 0; r < rounds; r++) {
+    reset(features);
+    for (size_t i = 0; i < len; i++) {
+      protoConsume(&proto, stream[i]);
+    }
+  }
+  const double bytewise = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int r = 0; r < rounds; r++) {
+    reset(features);
+    for (size_t pos = 0; pos < len; pos += 80) {
+      protoConsumeBuffer(&proto, stream + pos, len - pos < 80 ? len - pos : 80);
+    }
+  }
+  const double buffered = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  const double mb = (double)len * rounds / 1e6;
+  printf("%-6s protoConsume %.1f MB/s, protoConsumeBuffer %.1f MB/s\n",
+         features & PROTO_FEATURE_CRC ? "crc:" : "plain:", mb / bytewise,
+         mb / buffered);
+}
+
+int main(int argc, char **argv) {
+  rngState = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_SEED;
+  if (rngState == 0)
+    rngState = 1;
+  printf("seed %lu\n", (unsigned long)rngState);
+  loadCorpus("corpus");
+
+  RUN(testCrcVectors);
+  RUN(testDuplicatesWithoutCrc);
+  RUN(testDuplicates);
+  RUN(testMalformed);
+  RUN(testCorpus);
+  RUN(testFragmented);
+  RUN(testFuzz);
+  RUN(testAckRequested);
+  RUN(testRefused);
+  RUN(testWindow);
+  benchmark(0);
+  benchmark(PROTO_FEATURE_CRC);
+
+  return testFailures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Encoder for keyframe animations played by the animationPlayback profile
+(format described in source/keyframes.h).
+
+Input is JSON:
+
+    {
+      "palette": ["000000", "ff0000", "00ff00"],
+      "frames": [
+        {"duration": 10,
+         "rows": ["11111111111111",
+                  "00000000000000",
+                  "00000000000000",
+                  "00000000000000",
+                  "22222222222222"]}
+      ]
+    }
+
+Each row has 14 hex digits - palette indices of keys in that row. Duration
+is in animation ticks (at most 255).
+
+The result is written to the output file. With --firmware, the firmware
+image is padded up to the animation region and the animation appended, so a
+single .bin can be flashed.
+"""
+
+import argparse
+import json
+import sys
+
+NUM_ROW = 5
+NUM_COLUMN = 14
+KEY_COUNT = NUM_ROW * NUM_COLUMN
+VERSION = 1
+MAX_PALETTE = 16
+
+FLASH_BASE = 0x4000
+ANIM_BASE = 0xF000
+ANIM_SIZE = 0x1000
+
+OP_SKIP = 0x00
+OP_RUN = 0x40
+OP_LITERAL = 0x80
+MAX_COUNT = 64
+
+
+def parse_frame(frame, palette_size):
+    rows = frame["rows"]
+    if len(rows) != NUM_ROW or any(len(r) != NUM_COLUMN for r in rows):
+        raise ValueError("frame needs %d rows of %d keys" %
+                         (NUM_ROW, NUM_COLUMN))
+    keys = [int(c, 16) for row in rows for c in row]
+    if max(keys) >= palette_size:
+        raise ValueError("palette index out of range")
+    duration = int(frame.get("duration", 1))
+    if not 1 <= duration <= 255:
+        raise ValueError("duration must be 1..255")
+    return duration, keys
+
+
+def run_length(keys, start, value):
+    n = 0
+    while start + n < KEY_COUNT and keys[start + n] == value and n < MAX_COUNT:
+        n += 1
+    return n
+
+
+def encode_frame(keys, previous):
+    """Greedy encoding; previous=None means no skips (keyframe)."""
+    out = bytearray()
+    i = 0
+    while i < KEY_COUNT:
+        if previous is not None and keys[i] == previous[i]:
+            n = 0
+            while (i + n < KEY_COUNT and keys[i + n] == previous[i + n] and
+                   n < MAX_COUNT):
+                n += 1
+            out.append(OP_SKIP | (n - 1))
+            i += n
+            continue
+
+        n = run_length(keys, i, keys[i])
+        if n >= 3:
+            out += bytes([OP_RUN | (n - 1), keys[i]])
+            i += n
+            continue
+
+        # Literal until a run or unchanged stretch is worth switching to
+        start = i
+        while i < KEY_COUNT and i - start < MAX_COUNT:
+            if run_length(keys, i, keys[i]) >= 3:
+                break
+            if (previous is not None and i + 1 < KEY_COUNT and
+                    keys[i] == previous[i] and keys[i + 1] == previous[i + 1]):
+                break
+            i += 1
+        literal = keys[start:i]
+        out.append(OP_LITERAL | (len(literal) - 1))
+        for j in range(0, len(literal), 2):
+            low = literal[j + 1] if j + 1 < len(literal) else 0
+            out.append((literal[j] << 4) | low)
+    return out
+
+
+def encode(doc):
+    palette = [bytes.fromhex(c.lstrip("#")) for c in doc["palette"]]
+    if not 1 <= len(palette) <= MAX_PALETTE:
+        raise ValueError("palette must have 1..%d colors" % MAX_PALETTE)
+    if any(len(c) != 3 for c in palette):
+        raise ValueError("colors must be RRGGBB")
+    frames = [parse_frame(f, len(palette)) for f in doc["frames"]]
+    if not 1 <= len(frames) <= 0xFFFF:
+        raise ValueError("wrong frame count")
+
+    out = bytearray(b"AP2A")
+    out += bytes([VERSION, len(palette)])
+    out += len(frames).to_bytes(2, "little")
+    for c in palette:
+        out += c
+
+    previous = None
+    for duration, keys in frames:
+        out.append(duration)
+        # The first frame follows the last one when looping - no skips
+        out += encode_frame(keys, previous)
+        previous = keys
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("input", type=argparse.FileType("r"))
+    parser.add_argument("output", type=argparse.FileType("wb"))
+    parser.add_argument("--firmware", type=argparse.FileType("rb"),
+                        help="firmware .bin to prepend")
+    args = parser.parse_args()
+
+    try:
+        data = encode(json.load(args.input))
+    except (ValueError, KeyError) as e:
+        sys.exit("error: " + str(e))
+    if len(data) > ANIM_SIZE:
+        sys.exit("error: animation has %d bytes, region is %d" %
+                 (len(data), ANIM_SIZE))
+
+    if args.firmware:
+        firmware = args.firmware.read()
+        limit = ANIM_BASE - FLASH_BASE
+        if len(firmware) > limit:
+            sys.exit("error: firmware overlaps the animation region")
+        data = firmware + b"\xff" * (limit - len(firmware)) + data
+
+    args.output.write(data)
+    print("%d bytes written" % len(data), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
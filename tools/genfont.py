@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Generates source/font.c - a 3x5 pixel font for the 5-row key matrix,
+covering ASCII 0x20 - 0x5F (lowercase letters are drawn as uppercase).
+
+Glyphs are stored column by column, one byte per column with bit n set when
+row n (from the top) is lit - the 1bpp bitmap format of source/text.h.
+
+Run from the repository root:
+
+    tools/genfont.py > source/font.c
+"""
+
+FIRST = 0x20
+WIDTH = 3
+
+# Rows top to bottom, '#' is lit
+GLYPHS = {
+    " ": ["...", "...", "...", "...", "..."],
+    "!": [".#.", ".#.", ".#.", "...", ".#."],
+    '"': ["#.#", "#.#", "...", "...", "..."],
+    "#": ["#.#", "###", "#.#", "###", "#.#"],
+    "$": [".##", "##.", ".#.", ".##", "##."],
+    "%": ["#..", "..#", ".#.", "#..", "..#"],
+    "&": [".#.", "#.#", ".#.", "#.#", ".##"],
+    "'": [".#.", ".#.", "...", "...", "..."],
+    "(": ["..#", ".#.", ".#.", ".#.", "..#"],
+    ")": ["#..", ".#.", ".#.", ".#.", "#.."],
+    "*": ["...", "#.#", ".#.", "#.#", "..."],
+    "+": ["...", ".#.", "###", ".#.", "..."],
+    ",": ["...", "...", "...", ".#.", "#.."],
+    "-": ["...", "...", "###", "...", "..."],
+    ".": ["...", "...", "...", "...", ".#."],
+    "/": ["..#", "..#", ".#.", "#..", "#.."],
+    "0": ["###", "#.#", "#.#", "#.#", "###"],
+    "1": [".#.", "##.", ".#.", ".#.", "###"],
+    "2": ["###", "..#", "###", "#..", "###"],
+    "3": ["###", "..#", "###", "..#", "###"],
+    "4": ["#.#", "#.#", "###", "..#", "..#"],
+    "5": ["###", "#..", "###", "..#", "###"],
+    "6": ["###", "#..", "###", "#.#", "###"],
+    "7": ["###", "..#", "..#", ".#.", ".#."],
+    "8": ["###", "#.#", "###", "#.#", "###"],
+    "9": ["###", "#.#", "###", "..#", "###"],
+    ":": ["...", ".#.", "...", ".#.", "..."],
+    ";": ["...", ".#.", "...", ".#.", "#.."],
+    "<": ["..#", ".#.", "#..", ".#.", "..#"],
+    "=": ["...", "###", "...", "###", "..."],
+    ">": ["#..", ".#.", "..#", ".#.", "#.."],
+    "?": ["###", "..#", ".##", "...", ".#."],
+    "@": ["###", "#.#", "###", "#..", "###"],
+    "A": [".#.", "#.#", "###", "#.#", "#.#"],
+    "B": ["##.", "#.#", "##.", "#.#", "##."],
+    "C": [".##", "#..", "#..", "#..", ".##"],
+    "D": ["##.", "#.#", "#.#", "#.#", "##."],
+    "E": ["###", "#..", "###", "#..", "###"],
+    "F": ["###", "#..", "###", "#..", "#.."],
+    "G": [".##", "#..", "#.#", "#.#", ".##"],
+    "H": ["#.#", "#.#", "###", "#.#", "#.#"],
+    "I": ["###", ".#.", ".#.", ".#.", "###"],
+    "J": ["..#", "..#", "..#", "#.#", ".#."],
+    "K": ["#.#", "#.#", "##.", "#.#", "#.#"],
+    "L": ["#..", "#..", "#..", "#..", "###"],
+    "M": ["#.#", "###", "#.#", "#.#", "#.#"],
+    "N": ["##.", "#.#", "#.#", "#.#", "#.#"],
+    "O": [".#.", "#.#", "#.#", "#.#", ".#."],
+    "P": ["##.", "#.#", "##.", "#..", "#.."],
+    "Q": [".#.", "#.#", "#.#", "###", ".##"],
+    "R": ["##.", "#.#", "##.", "#.#", "#.#"],
+    "S": [".##", "#..", ".#.", "..#", "##."],
+    "T": ["###", ".#.", ".#.", ".#.", ".#."],
+    "U": ["#.#", "#.#", "#.#", "#.#", "###"],
+    "V": ["#.#", "#.#", "#.#", "#.#", ".#."],
+    "W": ["#.#", "#.#", "###", "###", "#.#"],
+    "X": ["#.#", "#.#", ".#.", "#.#", "#.#"],
+    "Y": ["#.#", "#.#", ".#.", ".#.", ".#."],
+    "Z": ["###", "..#", ".#.", "#..", "###"],
+    "[": ["##.", "#..", "#..", "#..", "##."],
+    "\\": ["#..", "#..", ".#.", "..#", "..#"],
+    "]": [".##", "..#", "..#", "..#", ".##"],
+    "^": [".#.", "#.#", "...", "...", "..."],
+    "_": ["...", "...", "...", "...", "###"],
+}
+
+
+def columns(rows):
+    assert len(rows) == 5 and all(len(r) == WIDTH for r in rows)
+    return [sum(1 << y for y in range(5) if rows[y][x] == "#")
+            for x in range(WIDTH)]
+
+
+def main():
+    chars = [chr(c) for c in range(FIRST, FIRST + len(GLYPHS))]
+    assert set(chars) == set(GLYPHS)
+
+    print("/*")
+    print("    ===  font  ===")
+    print("    Generated by tools/genfont.py - do not edit.")
+    print("*/")
+    print('#include "text.h"')
+    print()
+    print("// clang-format off")
+    print("const uint8_t font3x5[%d][FONT_WIDTH] = {" % len(chars))
+    for c in chars:
+        cols = ", ".join("0x%02X" % v for v in columns(GLYPHS[c]))
+        comment = c if c not in "\\" else "backslash"
+        print("    {%s}, /* %s */" % (cols, comment))
+    print("};")
+    print("// clang-format on")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""
+Generates source/geometry.c - physical key positions of the Anne Pro 2 and
+lookup tables derived from them. Both C15 and C18 revisions wire the LEDs
+into the same 5x14 matrix, so a single table covers them.
+
+Run from the repository root:
+
+    tools/gengeometry.py > source/geometry.c
+"""
+
+import math
+
+NUM_ROW = 5
+NUM_COLUMN = 14
+# Units per 1u key
+UNIT = 8
+
+# Key widths per matrix column in 1u; None marks unused matrix positions.
+LAYOUT = [
+    [1] * 13 + [2],
+    [1.5] + [1] * 12 + [1.5],
+    [1.75] + [1] * 11 + [2.25, None],
+    [2.25, None] + [1] * 10 + [2.75, None],
+    [1.25, None, 1.25, 1.25, None, None, 6.25, None, None,
+     1.25, 1.25, 1.25, 1.25, None],
+]
+
+INVALID = 0xFF
+
+
+def key_centers():
+    centers = []
+    for row, widths in enumerate(LAYOUT):
+        assert len(widths) == NUM_COLUMN
+        x = 0
+        for w in widths:
+            if w is None:
+                centers.append(None)
+                continue
+            centers.append((round((x + w / 2) * UNIT), row * UNIT + UNIT // 2))
+            x += w
+    return centers
+
+
+def c_array(ctype, name, values, per_line=12, fmt="%d"):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(fmt % v for v in values[i:i + per_line])
+                     + ",")
+    return "const %s %s[%d] = {\n%s\n};\n" % (ctype, name, len(values),
+                                            "\n".join(lines))
+
+
+def main():
+    centers = key_centers()
+    width = 15 * UNIT
+    cx, cy = width / 2, NUM_ROW * UNIT / 2
+
+    xs = [c[0] if c else INVALID for c in centers]
+    ys = [c[1] if c else INVALID for c in centers]
+
+    valid_rows = []
+    for row in range(NUM_ROW):
+        mask = 0
+        for col in range(NUM_COLUMN):
+            if centers[row * NUM_COLUMN + col]:
+                mask |= 1 << col
+        valid_rows.append(mask)
+
+    center_dist = []
+    center_angle = []
+    for c in centers:
+        if c is None:
+            center_dist.append(INVALID)
+            center_angle.append(0)
+            continue
+        dx, dy = c[0] - cx, c[1] - cy
+        center_dist.append(min(254, round(math.hypot(dx, dy))))
+        # 0 points right, grows clockwise (rows go down), 256 is a full turn
+        center_angle.append(round(math.atan2(dy, dx) / (2 * math.pi) * 256)
+                            & 0xFF)
+
+    # Lower triangle without the diagonal: pair (a, b), a < b is stored at
+    # b * (b - 1) / 2 + a
+    pairs = []
+    for b in range(len(centers)):
+        for a in range(b):
+            ca, cb = centers[a], centers[b]
+            if ca is None or cb is None:
+                pairs.append(INVALID)
+            else:
+                pairs.append(min(254, round(math.hypot(ca[0] - cb[0],
+                                                       ca[1] - cb[1]))))
+
+    print("/*")
+    print("    ===  geometry  ===")
+    print("    Generated by tools/gengeometry.py - do not edit.")
+    print("*/")
+    print('#include "geometry.h"')
+    print()
+    print("// clang-format off")
+    print(c_array("uint16_t", "validKeyRows", valid_rows, fmt="0x%04X"))
+    print(c_array("uint8_t", "keyX", xs, 14))
+    print(c_array("uint8_t", "keyY", ys, 14))
+    print(c_array("uint8_t", "keyCenterDistance", center_dist, 14))
+    print(c_array("uint8_t", "keyCenterAngle", center_angle, 14))
+    print(c_array("uint8_t", "keyDistanceTable", pairs, 16), end="")
+    print("// clang-format on")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Assembler for the Shine effect VM (source/effectVM.h).
+
+Source format, one instruction per line:
+
+    ; plasma-ish example
+        col
+        time
+        add
+        sin8        ; hue
+        push 255    ; saturation
+        push 255    ; value
+        hsv
+
+Labels end with a colon and can only be targets of forward jumps
+(`jmp label`, `jz label`). `push` picks the 8 or 16 bit form automatically.
+
+Since every instruction may run once for each of the 70 keys, a program can
+have at most FRAME_BUDGET // KEY_COUNT = 29 instructions.
+
+The output is the program as hex bytes, or with --messages, the payloads of
+the CMD_LED_VM_LOAD / CMD_LED_VM_COMMIT messages needed to upload it.
+"""
+
+import argparse
+import sys
+
+MAX_PROGRAM = 128
+FRAME_BUDGET = 2048
+KEY_COUNT = 70
+# Payload size minus the offset byte
+CHUNK = 63
+
+# name: (opcode, immediate bytes); keep in sync with vm_opcode
+OPCODES = {
+    "end": (0x00, 0),
+    "push8": (0x01, 1),
+    "push16": (0x02, 2),
+    "row": (0x03, 0),
+    "col": (0x04, 0),
+    "time": (0x05, 0),
+    "dup": (0x06, 0),
+    "drop": (0x07, 0),
+    "swap": (0x08, 0),
+    "over": (0x09, 0),
+    "add": (0x0A, 0),
+    "sub": (0x0B, 0),
+    "mul": (0x0C, 0),
+    "scale8": (0x0D, 0),
+    "shr": (0x0E, 0),
+    "shl": (0x0F, 0),
+    "and": (0x10, 0),
+    "or": (0x11, 0),
+    "xor": (0x12, 0),
+    "min": (0x13, 0),
+    "max": (0x14, 0),
+    "sin8": (0x15, 0),
+    "cos8": (0x16, 0),
+    "tri8": (0x17, 0),
+    "ease8": (0x18, 0),
+    "noise": (0x19, 0),
+    "rand8": (0x1A, 0),
+    "load": (0x1B, 1),
+    "store": (0x1C, 1),
+    "jmp": (0x1D, 1),
+    "jz": (0x1E, 1),
+    "hsv": (0x1F, 0),
+    "rgb": (0x20, 0),
+}
+
+VARIABLES = 8
+
+
+class AsmError(Exception):
+    pass
+
+
+def parse_int(text):
+    return int(text, 0)
+
+
+def assemble(source):
+    # First pass: compute sizes and label addresses
+    labels = {}
+    items = []
+    pc = 0
+    for lineno, line in enumerate(source.splitlines(), 1):
+        line = line.split(";", 1)[0].strip()
+        if not line:
+            continue
+        if line.endswith(":"):
+            labels[line[:-1]] = pc
+            continue
+        parts = line.split()
+        name, args = parts[0].lower(), parts[1:]
+        if name == "push":
+            if len(args) != 1:
+                raise AsmError("line %d: push needs one argument" % lineno)
+            value = parse_int(args[0])
+            name = "push8" if 0 <= value <= 255 else "push16"
+        if name not in OPCODES:
+            raise AsmError("line %d: unknown instruction %r" % (lineno, name))
+        opcode, imm = OPCODES[name]
+        if len(args) != (1 if imm else 0):
+            raise AsmError("line %d: wrong number of arguments" % lineno)
+        items.append((lineno, pc, name, opcode, imm, args))
+        pc += 1 + imm
+
+    # Second pass: emit bytes
+    code = bytearray()
+    for lineno, pc, name, opcode, imm, args in items:
+        code.append(opcode)
+        if name in ("jmp", "jz"):
+            if args[0] not in labels:
+                raise AsmError("line %d: unknown label %r" % (lineno, args[0]))
+            offset = labels[args[0]] - (pc + 2)
+            if offset < 0:
+                raise AsmError("line %d: only forward jumps are allowed" % lineno)
+            code.append(offset)
+        elif name in ("load", "store"):
+            index = parse_int(args[0])
+            if not 0 <= index < VARIABLES:
+                raise AsmError("line %d: no variable %d" % (lineno, index))
+            code.append(index)
+        elif imm == 1:
+            code.append(parse_int(args[0]) & 0xFF)
+        elif imm == 2:
+            value = parse_int(args[0])
+            if not -32768 <= value <= 32767:
+                raise AsmError("line %d: %d does not fit in 16 bits" %
+                               (lineno, value))
+            code += (value & 0xFFFF).to_bytes(2, "little")
+
+    if len(code) > MAX_PROGRAM:
+        raise AsmError("program has %d bytes, the limit is %d" %
+                       (len(code), MAX_PROGRAM))
+
+    # Same check as vmCommit: every instruction runs at most once per key
+    cost = len(items) * KEY_COUNT
+    if cost > FRAME_BUDGET:
+        raise AsmError("program has %d instructions, the limit is %d (a "
+                       "budget of %d per frame over %d keys)" %
+                       (len(items), FRAME_BUDGET // KEY_COUNT, FRAME_BUDGET,
+                        KEY_COUNT))
+    return bytes(code), cost
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().split("\n")[0])
+    parser.add_argument("source", type=argparse.FileType("r"))
+    parser.add_argument("--messages", action="store_true",
+                        help="print upload message payloads instead of code")
+    args = parser.parse_args()
+
+    try:
+        code, cost = assemble(args.source.read())
+    except AsmError as e:
+        sys.exit("error: " + str(e))
+
+    if args.messages:
+        for offset in range(0, len(code), CHUNK):
+            chunk = bytes([offset]) + code[offset:offset + CHUNK]
+            print("CMD_LED_VM_LOAD   0x60", chunk.hex(" "))
+        print("CMD_LED_VM_COMMIT 0x61", bytes([len(code)]).hex())
+    else:
+        print(code.hex(" "))
+    print("%d bytes, worst case %d/%d instructions per frame" %
+          (len(code), cost, FRAME_BUDGET), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()